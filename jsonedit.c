@@ -5,9 +5,11 @@
 #include "litejson.h"
 
 #define READ_STDIN_MIN 12
+#define READ_STDIN_CHUNK 65536
 
 #define IS_HELP(option) (tolower(option[1]) == 'h' || option[1] == '?')
 #define IS_AN_OPTION(str) (strlen(str) >= 2 && str[0] == '-')
+#define IS_STDIN(fn) (!fn || (strlen(fn) < 2 && fn[0] == '-'))
 
 #define AUTOEXTEND_BUFFER(str, count, size) \
 { \
@@ -17,31 +19,28 @@
 	} \
 }
 
-char* read_stdin(void) {
-	// prepare our autoextendable buffer
-	json_index_t size = READ_STDIN_MIN;
-	json_index_t count = 0;
-	char* result = calloc(size, sizeof(char));
+/// parses stdin chunk by chunk as it arrives, without keeping all of it
+json_value_ref parse_stdin(json_error* errorP) {
+	json_stream_ref stream = json_stream_new_tree();
+	char chunk[READ_STDIN_CHUNK];
+	bool success = true;
 
-	while (feof(stdin) == 0) {
-		char current = fgetc(stdin);
+	while (success && feof(stdin) == 0 && ferror(stdin) == 0) {
+		const size_t count = fread(chunk, sizeof(char), READ_STDIN_CHUNK, stdin);
+		success = json_stream_feed(stream, chunk, count, errorP);
+	}
 
-		// save current character
-		result[count++] = current;
-		result[count] = '\0';
+	if (success)
+		success = json_stream_finish(stream, errorP);
 
-		// need to autoextend to prepare for more data
-		AUTOEXTEND_BUFFER(result, count, size)
-	}
+	json_value_ref result = json_stream_get_root(stream);
+	json_stream_release(stream);
 
 	return result;
 }
 
-/// reads the specified file path into a C string
-char* read_file(const char* fn) {
-	if (!fn || (strlen(fn) < 2 && fn[0] == '-'))
-		return read_stdin(); // reading from stdin in this case
-
+/// reads the specified file path into a C string, storing its byte count in *lengthP
+char* read_file(const char* fn, json_index_t* lengthP) {
 	FILE* stream = fopen(fn, "r");
 
 	if (!stream) {
@@ -60,7 +59,10 @@ char* read_file(const char* fn) {
 
 	// now read in everything into a buffer
 	char* result = calloc(size + 1, sizeof(char));
-	fread(result, sizeof(char), size, stream);
+	size = fread(result, sizeof(char), size, stream);
+
+	if (lengthP)
+		(*lengthP) = size;
 
 	// clean up
 	fclose(stream);
@@ -234,25 +236,31 @@ int main(const int argc, const char** argv) {
 	const char* query = argv[2];
 	const char* filename = argv[3];
 
-	// read in file contents and parse it first
-	char* raw = read_file(filename);
-	if (!raw)
-		return 1; // fail
-
 	json_error error;
-	json_value_ref root = json_parse(raw, &error);
+	json_value_ref root = NULL;
+
+	if (IS_STDIN(filename)) {
+		// stdin is parsed while it is still being read
+		root = parse_stdin(&error);
+	} else {
+		// read in file contents and parse it first
+		json_index_t rawLength = 0;
+		char* raw = read_file(filename, &rawLength);
+		if (!raw)
+			return 1; // fail
+
+		root = json_parse_n(raw, rawLength, &error);
+		free(raw);
+	}
 
 	if (error.fail) {
 		fprintf(stderr, "Parsing error - line %u, character %u, %s\n",
 				error.line, error.character, error.message);
 
 		// clean up and exit
-		free(raw);
 		return 2;
 	}
 
-	free(raw);
-
 	switch (option[1]) {
 		case 'g': {
 			// -get
@@ -267,19 +275,22 @@ int main(const int argc, const char** argv) {
 			json_type_t type = json_value_get_type(result);
 
 			switch (type) {
-				case JSON_TYPE_ARRAY:
-				case JSON_TYPE_OBJECT: {
-					// containers need stringification first
+				case JSON_TYPE_STRING: {
+					printf("%s\n", json_value_get_string(result));
+					break;
+				}
+				case JSON_TYPE_NULL: {
+					printf("%c", '\n');
+					break;
+				}
+				default: {
+					// everything else needs stringification first
 					char* strV = json_value_stringify(result, false);
 					printf("%s\n", strV);
 
 					free(strV);
 					break;
 				}
-				default: {
-					printf("%s\n", json_value_get_string(result));
-					break;
-				}
 			}
 
 			break;
@@ -2,6 +2,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
+#include <float.h>
+#include <locale.h>
 #include "litejson.h"
 
 //
@@ -11,16 +14,49 @@
 /// max length of json_error.message field
 #define LJ_ERROR_CHARMAX 512
 
-/// internally-used base size for automatically extendable C 
-/// string buffers
-#define LJ_STRINGOPS_BUFSTEP 20
-/// max length of ljftoa C string buffer
-#define LJ_STRINGOPS_NUMMAX 10
+/// internally-used initial size of automatically extendable C string
+/// buffers, each next reallocation doubles it
+#define LJ_STRINGOPS_BUFBASE 256
+/// max length of a formatted number (lj_format_number, lj_format_integer)
+#define LJ_STRINGOPS_NUMMAX 32
 /// const parameter that is used as a "sign" to lj_substring_until to
 /// use a common set of JSON token delimiters as its border
 #define LJ_STRINGOPS_JSONTOK '\r'
 /// JSON document generation soft tab size
 #define LJ_STRINGOPS_TABSIZE 3
+/// amount of buffered json_writer output that gets handed to its callback
+#define LJ_WRITER_FLUSHSIZE 4096
+
+/// first json_document arena block size, each next block doubles it
+#define LJ_ARENA_BLOCKSIZE 4096
+/// upper limit for the doubling of json_document arena blocks
+#define LJ_ARENA_BLOCKMAX 1048576
+/// alignment of every single arena allocation
+#define LJ_ARENA_ALIGN 8
+
+/// value flag - the value itself and all of its strings live in an arena
+#define LJ_VALUE_IN_ARENA 0x01
+/// value flag - key memory is not owned by the value (must not be freed)
+#define LJ_VALUE_BORROWED_KEY 0x02
+/// value flag - strV memory is not owned by the value (must not be freed)
+#define LJ_VALUE_BORROWED_STR 0x04
+/// value flag - the number is stored exactly in intV
+#define LJ_VALUE_INT64 0x08
+/// value flag - the number is stored exactly in uintV
+#define LJ_VALUE_UINT64 0x10
+/// value flag - the key is stored inside the value itself (key.inl)
+#define LJ_VALUE_INLINE_KEY 0x20
+/// value flag - the string is stored inside the value itself (v.strI)
+#define LJ_VALUE_INLINE_STR 0x40
+/// value flag - heap memory of the key and string is sized for lj_pool reuse
+#define LJ_VALUE_POOLED 0x80
+
+/// keys up to this long are stored inside the value instead of the heap
+#define LJ_VALUE_INLINE_KEYMAX 15
+/// strings up to this long are stored inside the value instead of the heap
+#define LJ_VALUE_INLINE_STRMAX 23
+/// keyLength of keys that are too long for it, see LJ_VALUE_KEYLEN
+#define LJ_VALUE_KEYLENGTH_LONG UINT16_MAX
 
 #ifdef LJ_DEBUG_ALLOW_COLORS
 #define LJ_PRINTF_ADDRESS "\033[93m"
@@ -35,27 +71,71 @@
 #endif
 
 struct json_value_s {
+#ifdef LJ_VALUE_PARENT
 	// value parent container, NULL if this is the root 
 	// one
 	json_value_ref parent;
+#endif
+	// next item of the parent container
+	json_value_ref next;
+	// key/label if stored in an object, see LJ_VALUE_KEY
+	union {
+		struct {
+			char* ptr;
+			// exact length of keys of LJ_VALUE_KEYLENGTH_LONG
+			json_index_t length;
+		} ext;
+		char inl[LJ_VALUE_INLINE_KEYMAX + 1];
+	} key;
 	
 	// stored value type
-	json_type_t type;
-	
-	// key/label if stored in an object
-	char* key;
-	
-	// string value
-	char* strV;
-	// numeric value
-	json_number_t numV;
+	uint8_t type;
+	// LJ_VALUE_* ownership and representation flags
+	uint8_t flags;
+	// key length, see LJ_VALUE_KEYLENGTH_LONG
+	uint16_t keyLength;
+	// child item count (container-only) or string length (string-only)
+	json_index_t count;
 	
-	// first child item (container-only)
-	json_value_ref child;
-	// next item
-	json_value_ref next;
+	// type-specific payload
+	union {
+		// JSON_TYPE_STRING, see LJ_VALUE_STR
+		char* strV;
+		char strI[LJ_VALUE_INLINE_STRMAX + 1];
+		// JSON_TYPE_NUMBER, picked by LJ_VALUE_INT64/LJ_VALUE_UINT64
+		json_number_t numV;
+		int64_t intV;
+		uint64_t uintV;
+		// JSON_TYPE_BOOLEAN
+		bool boolV;
+		
+		// JSON_TYPE_ARRAY, JSON_TYPE_OBJECT
+		struct {
+			// first and last child items
+			json_value_ref child;
+			json_value_ref last;
+			
+			union {
+				// hash index of child keys (large objects only)
+				struct lj_keyindex_s* keys;
+				// contiguous vector of children (large arrays only)
+				struct lj_itemvector_s* items;
+			} index;
+		} c;
+	} v;
 };
 
+/// key of the specified value, NULL if it has none
+#define LJ_VALUE_KEY(value) \
+	(((value)->flags & LJ_VALUE_INLINE_KEY) ? (value)->key.inl : (value)->key.ext.ptr)
+/// length of the key of the specified value, 0 if it has none
+#define LJ_VALUE_KEYLEN(value) \
+	(((value)->keyLength != LJ_VALUE_KEYLENGTH_LONG) ? \
+		(size_t)(value)->keyLength : (size_t)(value)->key.ext.length)
+/// NUL-terminated contents of the specified string value
+#define LJ_VALUE_STR(value) \
+	(((value)->flags & LJ_VALUE_INLINE_STR) ? (value)->v.strI : (value)->v.strV)
+
 void ljprintf(const char* fn, const json_index_t line, const char* fc,
 			  const char* msgF, ...) {
 #ifdef DEBUG
@@ -89,7 +169,17 @@ void* ljmalloc(const json_index_t size) {
 		return NULL; // obv
 		
 	void* result = malloc(size);
-	bzero(result, size);
+	memset(result, 0, size);
+	
+	return result;
+}
+
+/// strdup replacement, as the former is not a part of C99
+char* ljstrdup(const char* input) {
+	const size_t length = strlen(input);
+	
+	char* result = ljmalloc(length + 1);
+	memcpy(result, input, length);
 	
 	return result;
 }
@@ -97,591 +187,3285 @@ void* ljmalloc(const json_index_t size) {
 /// convenience wrapper for zero malloc-ing new struct instances
 #define ljmalloc_s(nm) ljmalloc(sizeof(struct nm))
 
-//
-// json_parse - private
-//
+/// single chunk of memory handed out by lj_arena
+typedef struct lj_arena_block_s {
+	struct lj_arena_block_s* next;
+	
+	size_t size;
+	size_t used;
+	
+	// the actual memory follows this header
+} lj_arena_block;
 
-///
-/// creates a new instance of the json_error structure with the provided
-/// data being saved
-///
-json_error json_error_make(const json_index_t line,
-						   const json_index_t character,
-						   const char* msgF,
-						   ...) {
-	json_error result = { (msgF ? true : false), line, character, NULL };
+/// internally-used bump allocator, released all at once
+typedef struct {
+	// the block currently allocated from, older ones are linked after it
+	lj_arena_block* head;
+} lj_arena;
+
+/// allocates zeroed memory from the specified arena
+void* lj_arena_alloc(lj_arena* arena, size_t size) {
+	size = (size + LJ_ARENA_ALIGN - 1) & ~((size_t)LJ_ARENA_ALIGN - 1);
 	
-	if (msgF) {
-		// merge the specified error message template with its parameters
-		// into a single string
-		
-		char* msg = calloc(LJ_ERROR_CHARMAX, sizeof(char)); 
-		
-		va_list vl;
-		va_start(vl, msgF);
+	lj_arena_block* block = arena->head;
+	
+	if (!block || (block->used + size) > block->size) {
+		// need a new block, at least twice as big as the previous one
+		size_t blockSize = block ? block->size * 2 : LJ_ARENA_BLOCKSIZE;
 		
-		vsprintf(msg, msgF, vl);
+		if (blockSize > LJ_ARENA_BLOCKMAX)
+			blockSize = LJ_ARENA_BLOCKMAX;
+		if (blockSize < size)
+			blockSize = size;
 		
-		va_end(vl);
+		// calloc gives us zeroed memory, and arena memory is never reused
+		const size_t headerSize = (sizeof(lj_arena_block) + LJ_ARENA_ALIGN - 1) &
+								  ~((size_t)LJ_ARENA_ALIGN - 1);
+		block = calloc(1, headerSize + blockSize);
+		block->size = headerSize + blockSize;
+		block->used = headerSize;
 		
-		result.message = msg;
+		block->next = arena->head;
+		arena->head = block;
 	}
 	
+	void* result = (char*)block + block->used;
+	block->used += size;
+	
 	return result;
 }
 
-/// sets *p1 to p2 if p1 is a valid pointer
-#define LJ_IF_NOT_NULL(p1, p2) \
-{ \
-	if (p1) \
-		(*p1) = p2; \
+/// releases all memory handed out by the specified arena
+void lj_arena_release(lj_arena* arena) {
+	lj_arena_block* block = arena->head;
+	
+	while (block) {
+		lj_arena_block* next = block->next;
+		free(block);
+		
+		block = next;
+	}
+	
+	arena->head = NULL;
 }
 
-/// cleans up json_parse-related vars and throws a parsing error
-#define LJ_ERROR(...) \
-{ \
-	if (value) \
-		json_value_release_tree(value); \
-	LJ_IF_NOT_NULL(errorP, json_error_make(lineC, charC, __VA_ARGS__)) \
-	return NULL; \
+/// moves all memory handed out by other into the specified arena
+void lj_arena_adopt(lj_arena* arena, lj_arena* other) {
+	lj_arena_block* tail = other->head;
+	
+	if (!tail)
+		return;
+	
+	while (tail->next)
+		tail = tail->next;
+	
+	tail->next = arena->head;
+	arena->head = other->head;
+	other->head = NULL;
 }
 
-#define LJ_IS_CONTAINER(obj) (obj->type == JSON_TYPE_ARRAY || \
-							  obj->type == JSON_TYPE_OBJECT)
+//
+// structural indexing - private
+//
 
-/// checks if the specified character is a JSON delimiter token
-#define LJ_IS_JSONTOK(current) \
-	(isspace(current) != 0 || current == ']' || current == '}' || current == ',')
-			
-/// [json_parse only] convenience macro to setup a new empty json_value_ref
-#define LJ_INIT_EMPTY_OBJ(newObj) \
-json_value_ref newObj = ljmalloc_s(json_value_s); \
-\
-if (futureKey) { \
-	newObj->key = futureKey; \
-	futureKey = NULL; \
-} \
-\
-if (!root) \
-	root = newObj;
-							  
-#define LJ_ADAPT_OBJ_PARENT(newObj) \
-{ \
-	if (value) { \
-		if (LJ_IS_CONTAINER(value)) { \
-			newObj->parent = value; \
-			if (value->child) { \
-				json_value_ref lastChild = json_value_get_last(value); \
-				lastChild->next = newObj; \
-			} else \
-				value->child = newObj; \
-		} else { \
-			value->next = newObj; \
-			newObj->parent = value->parent; \
-		} \
-	} \
-}
+/// bytes classified at once by the structural indexer
+#define LJ_INDEX_BLOCK 64
+/// max amount of structural positions buffered by a single index refill
+#define LJ_INDEX_WINDOW 1024
+
+/// bit masks of interesting characters inside a single 64-byte block
+typedef struct {
+	uint64_t quote;
+	uint64_t backslash;
+	// {}[]:,
+	uint64_t structural;
+	// space, tab, CR, LF
+	uint64_t whitespace;
+} lj_block_masks;
+
+/// block classification routine, picked at runtime by lj_classify_select
+typedef void (*lj_classify_fn)(const uint8_t* block, lj_block_masks* masks);
 
 ///
-/// [json_parse] if we are a child item inside a container and we encounter
-/// a token meant to close that container, we need to jump to our parent
-/// container first and only then continue with closing it (jumping to its
-/// parent)
+/// structural index of a JSON document - the offsets of all the structural
+/// characters, opening doublequotes and first characters of scalars, found
+/// one window at a time so that its memory use stays bounded
 ///
-#define LJ_JUMP_TO_CHILDS_PARENT_MULTI(value, pType) \
-{ \
-	if (value && value->type != pType && \
-		value->parent && value->parent->type == pType) { \
-		\
-		ljprintf("additional level up from %p to %p, type %u -> %u", \
-				 value, value->parent, value->type, pType); \
-		value = value->parent; \
-	} \
+typedef struct {
+	const char* input;
+	size_t length;
+	// next input offset to be classified
+	size_t offset;
+
+	// state carried over from the previous block
+	uint64_t prevEscaped;
+	uint64_t prevInString;
+	uint64_t prevScalar;
+
+	// buffered positions and the next one to hand out
+	size_t positions[LJ_INDEX_WINDOW];
+	json_index_t count;
+	json_index_t cursor;
+	// positions buffered by the next refill, grows up to LJ_INDEX_WINDOW so
+	// that short documents aren't indexed far past their end
+	json_index_t window;
+} lj_index;
+
+/// portable count trailing zeroes, input must not be zero
+static inline json_index_t lj_ctz64(uint64_t input) {
+#if defined(__GNUC__)
+	return (json_index_t)__builtin_ctzll(input);
+#else
+	json_index_t result = 0;
+
+	while ((input & 1) == 0) {
+		input >>= 1;
+		result++;
+	}
+
+	return result;
+#endif
 }
 
-///
-/// [json_parse] adjust the state machine after jumping to the container's
-/// parent
-///
-#define LJ_CLOSE_AND_JUMP_TO_PARENT(value) \
-{ \
-	if (value->parent) { \
-		ljprintf("%s going up one level from %p to %p %s", \
-				 LJ_PRINTF_GREEN, value, value->parent, LJ_PRINTF_RESET); \
-		\
-		value = value->parent; \
-		\
-		if (value->type == JSON_TYPE_OBJECT) \
-			state = JSON_STATE_KEY; \
-		else if (value->type == JSON_TYPE_ARRAY) \
-			state = JSON_STATE_ARRAY; \
-		else \
-			state = JSON_STATE_KEY; \
-	} else { \
-		ljprintf("de facto end of file reached, saying goodbyes and finishing up"); \
-		break; \
-	} \
+/// portable count leading zeroes, input must not be zero
+static inline json_index_t lj_clz64(uint64_t input) {
+#if defined(__GNUC__)
+	return (json_index_t)__builtin_clzll(input);
+#else
+	json_index_t result = 0;
+
+	while (!(input & (UINT64_C(1) << 63))) {
+		input <<= 1;
+		result++;
+	}
+
+	return result;
+#endif
 }
 
-/// internally-used parsing state machine
-typedef enum {
-	JSON_STATE_OUTSIDE = 0,
-	
-	JSON_STATE_KEY = 90,
-	JSON_STATE_VALUE = 91,
-	
-	JSON_STATE_ARRAY = 80
-} json_parse_state_t;
+/// bit i of the result is the XOR of bits 0..i of the input
+static inline uint64_t lj_prefix_xor(uint64_t input) {
+	input ^= input << 1;
+	input ^= input << 2;
+	input ^= input << 4;
+	input ^= input << 8;
+	input ^= input << 16;
+	input ^= input << 32;
 
-///
-/// makes a substring at *resultP and returns its length. delim1 and delim2
-/// are parameters signifying the stop characters to look for while going through
-/// the main string. If respectQuotes is specified, then those stop characters
-/// are ignored when wrapped around in doublequotes
-///
-json_index_t lj_substring_until(const char* input, const char delim1,
-								const char delim2, char** resultP,
-								const bool respectQuotes) {
-	if (!input || strlen(input) < 1 || delim1 == '\0') {
-		// need to have at least one delimiter specified
-		ljprintf("input = \"%s\", while delim1 = %d, cannot continue", 
-				 input, (int8_t)delim1);
-		return 0;
-	} else if (input[0] == delim1 || input[0] == delim2)
-		input++; // chop off right to the start
-	
-	// automatically extendable buffer
-	json_index_t resultSize = LJ_STRINGOPS_BUFSTEP;
-	json_index_t resultLength = 0;
-	char* result = calloc(resultSize, sizeof(char));
-	
-	// if true, then we were preceded by a '\\'
-	bool insideEscape = false;
-	// if true, we are in double quotes (ignored without respectQuotes)
-	bool insideQuotes = false;
-		
-	for (json_index_t index = 0; index < strlen(input); index++) {
-		char current = input[index];
-		
-		// extend the buffer first if necessary
-		if ((resultLength + 2) >= resultSize) {
-			ljprintf("buffer limit reached (size = %u), result = \"%s\"",
-					 resultSize, result);
-					 
-			resultSize += LJ_STRINGOPS_BUFSTEP;
-			result = realloc(result, sizeof(char) * resultSize);
-		}
-	
-		if (insideEscape) {
-			// escape the character requested
-			switch (current) {
-				case 't': {
-					current = '\t';
-					break;
-				}
-				case 'n': {
-					current = '\n';
-					break;
-				}
-				case 'r': {
-					current = '\r';
-					break;
-				}
-				default:
-					break;
+	return input;
+}
+
+/// portable block classification, used where no SIMD variant is available
+void lj_classify_scalar(const uint8_t* block, lj_block_masks* masks) {
+	lj_block_masks result = { 0, 0, 0, 0 };
+
+	for (json_index_t i = 0; i < LJ_INDEX_BLOCK; i++) {
+		const uint64_t bit = (uint64_t)1 << i;
+
+		switch (block[i]) {
+			case '"': {
+				result.quote |= bit;
+				break;
 			}
-		} else if (current == '\\') {
-			insideEscape = true;
-			continue;
-		} else if (current == '"' && respectQuotes)
-			insideQuotes = !insideQuotes;
-		
-		if (!insideQuotes) {
-			if (current == delim1 || current == delim2)
-				break; // found 'em
-			else if (delim1 == LJ_STRINGOPS_JSONTOK && 
-					 LJ_IS_JSONTOK(current))
+			case '\\': {
+				result.backslash |= bit;
+				break;
+			}
+			case '{':
+			case '}':
+			case '[':
+			case ']':
+			case ':':
+			case ',': {
+				result.structural |= bit;
+				break;
+			}
+			case ' ':
+			case '\t':
+			case '\n':
+			case '\r': {
+				result.whitespace |= bit;
+				break;
+			}
+			default:
 				break;
 		}
-		
-		result[resultLength++] = current;
-		result[resultLength] = '\0';
-			
-		insideEscape = false;
 	}
-	
-	if (resultP)
-		(*resultP) = result;
-	else
-		free(result); // avoid memory leak
-		
-	return resultLength;
+
+	(*masks) = result;
+}
+
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(LJ_NO_SIMD)
+#define LJ_HAVE_X86_SIMD 1
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+/// SSE2 block classification, always available on x86-64
+void lj_classify_sse2(const uint8_t* block, lj_block_masks* masks) {
+	lj_block_masks result = { 0, 0, 0, 0 };
+
+	for (json_index_t i = 0; i < LJ_INDEX_BLOCK; i += 16) {
+		const __m128i chunk = _mm_loadu_si128((const __m128i*)(block + i));
+		// '[' and ']' only differ from '{' and '}' in the 0x20 bit
+		const __m128i folded = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+
+		const __m128i quote = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('"'));
+		const __m128i backslash = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'));
+
+		__m128i structural = _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')),
+										  _mm_cmpeq_epi8(folded, _mm_set1_epi8('}')));
+		structural = _mm_or_si128(structural, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(':')));
+		structural = _mm_or_si128(structural, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(',')));
+
+		__m128i whitespace = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')),
+										  _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t')));
+		whitespace = _mm_or_si128(whitespace, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')));
+		whitespace = _mm_or_si128(whitespace, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')));
+
+		result.quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(quote) << i;
+		result.backslash |= (uint64_t)(uint16_t)_mm_movemask_epi8(backslash) << i;
+		result.structural |= (uint64_t)(uint16_t)_mm_movemask_epi8(structural) << i;
+		result.whitespace |= (uint64_t)(uint16_t)_mm_movemask_epi8(whitespace) << i;
+	}
+
+	(*masks) = result;
+}
+
+/// AVX2 block classification, only used if the CPU and the OS support it
+__attribute__((target("avx2")))
+void lj_classify_avx2(const uint8_t* block, lj_block_masks* masks) {
+	lj_block_masks result = { 0, 0, 0, 0 };
+
+	for (json_index_t i = 0; i < LJ_INDEX_BLOCK; i += 32) {
+		const __m256i chunk = _mm256_loadu_si256((const __m256i*)(block + i));
+		const __m256i folded = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+
+		const __m256i quote = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"'));
+		const __m256i backslash = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'));
+
+		__m256i structural = _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')),
+											 _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}')));
+		structural = _mm256_or_si256(structural, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(':')));
+		structural = _mm256_or_si256(structural, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(',')));
+
+		__m256i whitespace = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')),
+											 _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t')));
+		whitespace = _mm256_or_si256(whitespace, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')));
+		whitespace = _mm256_or_si256(whitespace, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r')));
+
+		result.quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(quote) << i;
+		result.backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(backslash) << i;
+		result.structural |= (uint64_t)(uint32_t)_mm256_movemask_epi8(structural) << i;
+		result.whitespace |= (uint64_t)(uint32_t)_mm256_movemask_epi8(whitespace) << i;
+	}
+
+	(*masks) = result;
+}
+
+/// checks (via CPUID and XGETBV) if AVX2 can be used on this machine
+bool lj_cpu_has_avx2(void) {
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return false;
+	else if (!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX))
+		return false;
+
+	// the OS has to save the YMM registers on context switches too
+	unsigned int xcr0Low, xcr0High;
+	__asm__ ("xgetbv" : "=a" (xcr0Low), "=d" (xcr0High) : "c" (0));
+
+	if ((xcr0Low & 0x6) != 0x6)
+		return false;
+
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+		return false;
+
+	return (ebx & bit_AVX2) != 0;
+}
+#endif
+
+/// picks the fastest block classification routine supported by the CPU
+lj_classify_fn lj_classify_select(void) {
+	// the selection is idempotent, so racing threads can't do any harm here
+	static lj_classify_fn selected = NULL;
+
+	if (!selected) {
+#ifdef LJ_HAVE_X86_SIMD
+		selected = lj_cpu_has_avx2() ? lj_classify_avx2 : lj_classify_sse2;
+		ljprintf("structural indexing uses %s",
+				 (selected == lj_classify_avx2) ? "AVX2" : "SSE2");
+#else
+		selected = lj_classify_scalar;
+#endif
+	}
+
+	return selected;
 }
 
 ///
-/// strips all isspace() conforming characters from the specified C string's
-/// ending
+/// returns the mask of characters escaped by a backslash, including the ones
+/// escaped by a backslash at the very end of the previous block
 ///
-void lj_substring_strip_right(char* input) {
-	if (!input)
-		return;
-	
-	json_index_t length = strlen(input);
-	if (length < 1)
-		return;
-		
-	while (length >= 1) {
-		length--;
-		
-		if (isspace(input[length]) == 0)
-			break; // end space search
-			
-		input[length] = '\0';
+static inline uint64_t lj_index_escaped(lj_index* ix, uint64_t backslash) {
+	if (!backslash) {
+		const uint64_t escaped = ix->prevEscaped;
+		ix->prevEscaped = 0;
+
+		return escaped;
 	}
+
+	// a backslash escaped by the previous block doesn't escape anything
+	backslash &= ~(ix->prevEscaped);
+	const uint64_t followsEscape = (backslash << 1) | ix->prevEscaped;
+
+	// backslash runs starting on an odd bit have to be told apart from the
+	// ones starting on an even bit, adding the run starts does just that
+	const uint64_t evenBits = UINT64_C(0x5555555555555555);
+	const uint64_t oddStarts = backslash & ~evenBits & ~followsEscape;
+
+	const uint64_t evenStartRuns = oddStarts + backslash;
+	ix->prevEscaped = (evenStartRuns < oddStarts) ? 1 : 0;
+
+	return (evenBits ^ (evenStartRuns << 1)) & followsEscape;
 }
 
-/// verifies if the specified C string contains a stringified number
-bool ljisdigit_str(const char* input) {
-	if (!input)
-		return false; // nothing to look for
-		
-	for (json_index_t i = 0; i < strlen(input); i++) {
-		if (isdigit(input[i]) == 0 && input[i] != '-' && input[i] != '+' && input[i] != '.')
+/// classifies the next window of the input, discarding all handed out positions
+void lj_index_refill(lj_index* ix) {
+	const lj_classify_fn classify = lj_classify_select();
+
+	ix->count = 0;
+	ix->cursor = 0;
+
+	if (ix->window < LJ_INDEX_WINDOW)
+		ix->window = ix->window ? ix->window * 2 : LJ_INDEX_BLOCK * 2;
+
+	while (ix->offset < ix->length &&
+		   ix->count <= (ix->window - LJ_INDEX_BLOCK)) {
+		const uint8_t* block = (const uint8_t*)(ix->input + ix->offset);
+		uint8_t padded[LJ_INDEX_BLOCK];
+
+		if ((ix->length - ix->offset) < LJ_INDEX_BLOCK) {
+			// never read past the end, pad the last block with whitespace
+			memset(padded, ' ', LJ_INDEX_BLOCK);
+			memcpy(padded, block, ix->length - ix->offset);
+
+			block = padded;
+		}
+
+		lj_block_masks masks;
+		classify(block, &masks);
+
+		const uint64_t escaped = lj_index_escaped(ix, masks.backslash);
+		const uint64_t quote = masks.quote & ~escaped;
+
+		// includes the opening doublequote, but not the closing one
+		const uint64_t inString = lj_prefix_xor(quote) ^ ix->prevInString;
+		ix->prevInString = (inString >> 63) ? ~(uint64_t)0 : 0;
+
+		const uint64_t scalar = ~(masks.structural | masks.whitespace | masks.quote) &
+								~inString;
+		const uint64_t scalarStarts = scalar & ~((scalar << 1) | ix->prevScalar);
+		ix->prevScalar = scalar >> 63;
+
+		uint64_t found = (masks.structural & ~inString) | (quote & inString) | scalarStarts;
+
+		while (found) {
+			ix->positions[ix->count++] = ix->offset + lj_ctz64(found);
+			found &= found - 1;
+		}
+
+		ix->offset += LJ_INDEX_BLOCK;
+	}
+}
+
+/// hands out the next structural position, returns false at the end of input
+static inline bool lj_index_next(lj_index* ix, size_t* positionP) {
+	if (ix->cursor >= ix->count) {
+		lj_index_refill(ix);
+
+		if (ix->count < 1)
 			return false;
 	}
-	
+
+	(*positionP) = ix->positions[ix->cursor++];
 	return true;
 }
 
-/// C string -> double
-json_number_t ljatof(const char* input) {
-	if (!ljisdigit_str(input))
-		return 0.0;
-	
-	json_number_t result = 0.0; 
-	sscanf(input, "%lf", &result);
-	
+//
+// value pool - private
+//
+
+/// smallest pooled buffer, shorter strings are stored inline anyway
+#define LJ_POOL_BUFFERMIN 32
+/// amount of pooled buffer sizes (LJ_POOL_BUFFERMIN, twice that, ...)
+#define LJ_POOL_CLASSES 20
+/// max amount of released values kept by a single pool
+#define LJ_POOL_VALUEMAX 1048576
+/// max amount of memory kept by a single pool in released buffers of each size
+#define LJ_POOL_CLASSBYTES 16777216
+
+///
+/// memory kept by json_parser for reuse - released values and buffers (of
+/// strings, key indexes and item vectors), as well as the work buffers of
+/// the previous parse
+///
+typedef struct {
+	// released values, linked through their next pointers
+	json_value_ref values;
+	json_index_t valueCount;
+
+	// released buffers of each size, linked through their first bytes
+	void* buffers[LJ_POOL_CLASSES];
+	json_index_t bufferCounts[LJ_POOL_CLASSES];
+
+	// lj_parser and lj_builder container stacks and the unescaping buffer
+	json_type_t* parseStack;
+	json_index_t parseStackSize;
+	json_value_ref* buildStack;
+	json_index_t buildStackSize;
+	char* scratch;
+	size_t scratchSize;
+} lj_pool;
+
+/// size class of buffers of size bytes, LJ_POOL_CLASSES if too big for one
+static inline json_index_t lj_pool_class(const size_t size) {
+	json_index_t result = 0;
+
+	while (result < LJ_POOL_CLASSES && ((size_t)LJ_POOL_BUFFERMIN << result) < size)
+		result++;
+
 	return result;
 }
 
-//
-// json_parse - public
-//
+/// actual size of the buffers handed out by lj_pool_buffer for size bytes
+static inline size_t lj_pool_buffer_size(const size_t size) {
+	const json_index_t sizeClass = lj_pool_class(size);
 
-void json_value_dump_tree(json_value_ref value, const json_index_t offset) {
-	if (!value)
-		fprintf(stderr, "(null value)\n");
-	else {
-		// type out the correct amount of spaces
-		for (json_index_t i = 0; i < offset; i++)
-			fprintf(stderr, "%c", ' ');
+	if (sizeClass >= LJ_POOL_CLASSES)
+		return size;
 
+	return (size_t)LJ_POOL_BUFFERMIN << sizeClass;
+}
 
-		fprintf(stderr, "%s%p%s ", LJ_PRINTF_ADDRESS, value, LJ_PRINTF_RESET);
-	
-		if (value->key)
-			fprintf(stderr, "key = \"%s\", ", value->key);
-		else
-			fprintf(stderr, "no key, ");
-			
-		fprintf(stderr, "type = %u, container = %s, strV = \"%s\", numV = %f, parent = %p\n", 
-				value->type, LJ_IS_CONTAINER(value) ? "true" : "false", value->strV, value->numV,
-				value->parent);
-		
-		if (value->child)
-			json_value_dump_tree(value->child, offset + 1);
-		
-		if (value->next)
-			json_value_dump_tree(value->next, offset);
-	}
+///
+/// takes a buffer of at least size bytes out of the pool (if there is one),
+/// or allocates one rounded up to its size class. The buffer isn't zeroed
+///
+void* lj_pool_buffer(lj_pool* pool, const size_t size) {
+	const json_index_t sizeClass = lj_pool_class(size);
+
+	if (!pool || sizeClass >= LJ_POOL_CLASSES || !pool->buffers[sizeClass])
+		return malloc(lj_pool_buffer_size(size));
+
+	void* result = pool->buffers[sizeClass];
+	memcpy(&(pool->buffers[sizeClass]), result, sizeof(void*));
+	pool->bufferCounts[sizeClass]--;
+
+	return result;
 }
 
-json_value_ref json_parse(const char* input, json_error* errorP) {
-	if (!input || strlen(input) < 1) {
-		// don't bother parsing empty strings
-		
-		LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, "NULL or empty string provided as input"));
-		return NULL;
+///
+/// returns a buffer taken from lj_pool_buffer for size bytes to the pool,
+/// or frees it if there is none
+///
+void lj_pool_release_buffer(lj_pool* pool, void* buffer, const size_t size) {
+	const json_index_t sizeClass = lj_pool_class(size);
+
+	if (!pool || sizeClass >= LJ_POOL_CLASSES ||
+		pool->bufferCounts[sizeClass] >=
+			((json_index_t)(LJ_POOL_CLASSBYTES / LJ_POOL_BUFFERMIN) >> sizeClass)) {
+		free(buffer);
+		return;
 	}
+
+	memcpy(buffer, &(pool->buffers[sizeClass]), sizeof(void*));
+	pool->buffers[sizeClass] = buffer;
+	pool->bufferCounts[sizeClass]++;
+}
+
+/// takes a zeroed value out of the pool, or allocates a new one
+json_value_ref lj_pool_value(lj_pool* pool) {
+	json_value_ref result = pool->values;
+
+	if (!result)
+		result = ljmalloc_s(json_value_s);
+	else {
+		pool->values = result->next;
+		pool->valueCount--;
+
+		memset(result, 0, sizeof(struct json_value_s));
+	}
+
+	result->flags = LJ_VALUE_POOLED;
+	return result;
+}
+
+/// releases all the memory kept by the pool
+void lj_pool_cleanup(lj_pool* pool) {
+	while (pool->values) {
+		json_value_ref next = pool->values->next;
+
+		free(pool->values);
+		pool->values = next;
+	}
+
+	for (json_index_t i = 0; i < LJ_POOL_CLASSES; i++) {
+		while (pool->buffers[i]) {
+			void* next = NULL;
+			memcpy(&next, pool->buffers[i], sizeof(void*));
+
+			free(pool->buffers[i]);
+			pool->buffers[i] = next;
+		}
+	}
+
+	free(pool->parseStack);
+	free(pool->buildStack);
+	free(pool->scratch);
+
+	memset(pool, 0, sizeof(lj_pool));
+}
+
+//
+// object key index - private
+//
+
+/// objects with more children than this get a hash index of their keys
+#define LJ_KEYINDEX_THRESHOLD 32
+
+/// single slot of the object key index
+typedef struct {
+	// hash of the key, compared before the key itself
+	uint32_t hash;
+	// indexed child value, NULL if the slot is empty
+	json_value_ref value;
+	// child value directly preceding it, NULL if it is the first one
+	json_value_ref previous;
+} lj_keyindex_slot;
+
+///
+/// open addressing hash table mapping child keys of an object to the child
+/// values, only ever built for large objects. Duplicate keys map to their
+/// first occurrence, just like json_value_find_by_key would find it
+///
+typedef struct lj_keyindex_s {
+	// slot count, always a power of two
+	json_index_t size;
+	// occupied slot count
+	json_index_t used;
+	// children that were not indexed because their key was already taken
+	json_index_t duplicates;
+
+	lj_keyindex_slot slots[];
+} lj_keyindex;
+
+/// saves the length of the key of the specified value, see LJ_VALUE_KEYLEN
+static inline void lj_value_store_key_length(json_value_ref value, const size_t length) {
+	if (length < LJ_VALUE_KEYLENGTH_LONG)
+		value->keyLength = (uint16_t)length;
+	else {
+		// only keys too long to be stored inline can get here
+		value->keyLength = LJ_VALUE_KEYLENGTH_LONG;
+		value->key.ext.length = (json_index_t)length;
+	}
+}
+
+/// checks if the key of the specified value is the same as length bytes of key
+static inline bool lj_value_key_equals(const json_value_ref value, const char* key,
+									   const size_t length) {
+	const char* own = LJ_VALUE_KEY(value);
+
+	return own && LJ_VALUE_KEYLEN(value) == length && memcmp(own, key, length) == 0;
+}
+
+/// FNV-1a hash of length bytes of the specified key
+static inline uint32_t lj_keyindex_hash(const char* key, const size_t length) {
+	uint32_t result = UINT32_C(2166136261);
+
+	for (size_t i = 0; i < length; i++) {
+		result ^= (uint8_t)key[i];
+		result *= UINT32_C(16777619);
+	}
+
+	return result;
+}
+
+///
+/// creates an empty key index, allocated from the arena if one is specified,
+/// otherwise taken from the pool (if there is one)
+///
+lj_keyindex* lj_keyindex_new(lj_arena* arena, lj_pool* pool, const json_index_t size) {
+	const size_t bytes = sizeof(lj_keyindex) + sizeof(lj_keyindex_slot) * size;
+	lj_keyindex* result = NULL;
+
+	if (arena)
+		result = lj_arena_alloc(arena, bytes);
+	else {
+		result = lj_pool_buffer(pool, bytes);
+		memset(result, 0, bytes);
+	}
+
+	result->size = size;
+	return result;
+}
+
+/// releases a key index that didn't come from an arena, into the pool if there is one
+void lj_keyindex_release(lj_keyindex* index, lj_arena* arena, lj_pool* pool) {
+	if (!arena && index)
+		lj_pool_release_buffer(pool, index, sizeof(lj_keyindex) +
+									  sizeof(lj_keyindex_slot) * index->size);
+}
+
+/// finds the slot for the specified key (either its own or an empty one)
+static inline lj_keyindex_slot* lj_keyindex_slot_for(lj_keyindex* index,
+													 const char* key,
+													 const size_t length,
+													 const uint32_t hash) {
+	const json_index_t mask = index->size - 1;
+	json_index_t position = hash & mask;
+
+	while (true) {
+		lj_keyindex_slot* slot = &(index->slots[position]);
+
+		if (!slot->value ||
+			(slot->hash == hash && lj_value_key_equals(slot->value, key, length)))
+			return slot;
+
+		position = (position + 1) & mask;
+	}
+}
+
+///
+/// retreives the child value with the specified key, NULL if there is none.
+/// *previousP is set to the child value directly preceding it
+///
+json_value_ref lj_keyindex_find(lj_keyindex* index, const char* key,
+								const size_t length, json_value_ref* previousP) {
+	const lj_keyindex_slot* slot = lj_keyindex_slot_for(index, key, length,
+														lj_keyindex_hash(key, length));
+
+	if (previousP)
+		(*previousP) = slot->previous;
+
+	return slot->value;
+}
+
+/// remembers previous as the child value directly preceding value, if the latter is indexed
+void lj_keyindex_relink(lj_keyindex* index, json_value_ref value,
+						json_value_ref previous) {
+	const char* key = LJ_VALUE_KEY(value);
+	const size_t length = LJ_VALUE_KEYLEN(value);
+
+	lj_keyindex_slot* slot = lj_keyindex_slot_for(index, key, length,
+												  lj_keyindex_hash(key, length));
+
+	if (slot->value == value)
+		slot->previous = previous;
+}
+
+///
+/// adds the specified child value (directly preceded by previous) to the
+/// index at *indexP, growing it if needed. Nothing changes if a child with
+/// the same key is already indexed
+///
+void lj_keyindex_insert(lj_keyindex** indexP, lj_arena* arena, lj_pool* pool,
+						json_value_ref value, json_value_ref previous) {
+	lj_keyindex* index = (*indexP);
+
+	if ((index->used + 1) * 2 > index->size) {
+		// keep the load factor at 50% at most
+		lj_keyindex* grown = lj_keyindex_new(arena, pool, index->size * 2);
+
+		for (json_index_t i = 0; i < index->size; i++) {
+			const lj_keyindex_slot* slot = &(index->slots[i]);
+
+			if (slot->value)
+				(*lj_keyindex_slot_for(grown, LJ_VALUE_KEY(slot->value),
+									   LJ_VALUE_KEYLEN(slot->value), slot->hash)) = (*slot);
+		}
+
+		grown->used = index->used;
+		grown->duplicates = index->duplicates;
+		lj_keyindex_release(index, arena, pool);
+
+		index = grown;
+		(*indexP) = grown;
+	}
+
+	const char* key = LJ_VALUE_KEY(value);
+	const size_t length = LJ_VALUE_KEYLEN(value);
+
+	const uint32_t hash = lj_keyindex_hash(key, length);
+	lj_keyindex_slot* slot = lj_keyindex_slot_for(index, key, length, hash);
+
+	if (!slot->value) {
+		slot->hash = hash;
+		slot->value = value;
+		slot->previous = previous;
+
+		index->used++;
+	} else
+		index->duplicates++;
+}
+
+///
+/// removes the specified child value (directly preceded by previous) from the
+/// index, before it gets unlinked. If it had duplicates further in the list,
+/// the next one of them takes its place
+///
+void lj_keyindex_remove(lj_keyindex* index, json_value_ref value,
+						json_value_ref previous) {
+	const json_index_t mask = index->size - 1;
+	const char* key = LJ_VALUE_KEY(value);
+	const size_t length = LJ_VALUE_KEYLEN(value);
+
+	lj_keyindex_slot* slot = lj_keyindex_slot_for(index, key, length,
+												  lj_keyindex_hash(key, length));
+
+	// the next child value is going to follow the previous one
+	if (value->next)
+		lj_keyindex_relink(index, value->next, previous);
+
+	if (slot->value != value) {
+		// this is an unindexed duplicate itself
+		index->duplicates--;
+		return;
+	}
+
+	// backward shift deletion - move every entry of the probe sequence that
+	// would become unreachable into the hole
+	json_index_t hole = (json_index_t)(slot - index->slots);
+	json_index_t position = hole;
+
+	while (true) {
+		position = (position + 1) & mask;
+		const lj_keyindex_slot* next = &(index->slots[position]);
+
+		if (!next->value)
+			break;
+
+		const json_index_t ideal = next->hash & mask;
+
+		if (((position - ideal) & mask) >= ((position - hole) & mask)) {
+			index->slots[hole] = (*next);
+			hole = position;
+		}
+	}
+
+	index->slots[hole].value = NULL;
+	index->used--;
+
+	if (index->duplicates > 0) {
+		json_value_ref otherBack = previous;
+
+		for (json_value_ref other = value->next; other; other = other->next) {
+			if (lj_value_key_equals(other, key, length)) {
+				// can't grow the index, as it just got one entry smaller
+				index->duplicates--;
+				lj_keyindex_insert(&index, NULL, NULL, other, otherBack);
+				break;
+			}
+
+			otherBack = other;
+		}
+	}
+}
+
+/// points the index entry of the previous child value to its replacement
+void lj_keyindex_replace(lj_keyindex* index, json_value_ref previous,
+						 json_value_ref value) {
+	const char* key = LJ_VALUE_KEY(previous);
+	const size_t length = LJ_VALUE_KEYLEN(previous);
+
+	lj_keyindex_slot* slot = lj_keyindex_slot_for(index, key, length,
+												  lj_keyindex_hash(key, length));
+
+	if (slot->value == previous)
+		slot->value = value;
+}
+
+/// builds the key index of the specified object from its current children
+lj_keyindex* lj_keyindex_build(json_value_ref container, lj_arena* arena,
+							   lj_pool* pool) {
+	json_index_t size = LJ_KEYINDEX_THRESHOLD * 4;
+	lj_keyindex* result = lj_keyindex_new(arena, pool, size);
+	json_value_ref previous = NULL;
+
+	for (json_value_ref child = container->v.c.child; child; child = child->next) {
+		lj_keyindex_insert(&result, arena, pool, child, previous);
+		previous = child;
+	}
+
+	ljprintf("built key index for <%p>, %u keys", container, result->used);
+	return result;
+}
+
+//
+// array item vector - private
+//
+
+/// arrays with more children than this get a contiguous vector of them
+#define LJ_ITEMVECTOR_THRESHOLD 8
+
+///
+/// growable contiguous storage of array children, giving O(1) indexed
+/// access on top of the regular linked list of children
+///
+typedef struct lj_itemvector_s {
+	// stored item count
+	json_index_t count;
+	// allocated item count
+	json_index_t size;
+
+	json_value_ref items[];
+} lj_itemvector;
+
+///
+/// creates an empty item vector, allocated from the arena if one is specified,
+/// otherwise taken from the pool (if there is one) and filling all of its buffer
+///
+lj_itemvector* lj_itemvector_new(lj_arena* arena, lj_pool* pool, json_index_t size) {
+	size_t bytes = sizeof(lj_itemvector) + sizeof(json_value_ref) * size;
+	lj_itemvector* result = NULL;
+
+	if (arena)
+		result = lj_arena_alloc(arena, bytes);
+	else {
+		bytes = lj_pool_buffer_size(bytes);
+		size = (json_index_t)((bytes - sizeof(lj_itemvector)) / sizeof(json_value_ref));
+
+		result = lj_pool_buffer(pool, bytes);
+		result->count = 0;
+	}
+
+	result->size = size;
+	return result;
+}
+
+/// releases an item vector that didn't come from an arena, into the pool if there is one
+void lj_itemvector_release(lj_itemvector* vector, lj_arena* arena, lj_pool* pool) {
+	if (!arena && vector)
+		lj_pool_release_buffer(pool, vector, sizeof(lj_itemvector) +
+									   sizeof(json_value_ref) * vector->size);
+}
+
+/// appends the specified value to the vector at *vectorP, growing it if needed
+void lj_itemvector_push(lj_itemvector** vectorP, lj_arena* arena, lj_pool* pool,
+						json_value_ref value) {
+	lj_itemvector* vector = (*vectorP);
+
+	if (vector->count >= vector->size) {
+		// pooled and arena memory can't be reallocated, so just move everything
+		lj_itemvector* grown = lj_itemvector_new(arena, pool, vector->size * 2);
+		memcpy(grown->items, vector->items, sizeof(json_value_ref) * vector->count);
+
+		grown->count = vector->count;
+		lj_itemvector_release(vector, arena, pool);
+
+		vector = grown;
+		(*vectorP) = vector;
+	}
+
+	vector->items[vector->count++] = value;
+}
+
+/// removes the item at the specified position from the vector
+void lj_itemvector_remove(lj_itemvector* vector, const json_index_t where) {
+	memmove(vector->items + where, vector->items + where + 1,
+			sizeof(json_value_ref) * (vector->count - where - 1));
+	vector->count--;
+}
+
+/// builds the item vector of the specified array from its current children
+lj_itemvector* lj_itemvector_build(json_value_ref container, lj_arena* arena,
+								   lj_pool* pool) {
+	lj_itemvector* result = lj_itemvector_new(arena, pool, LJ_ITEMVECTOR_THRESHOLD * 4);
+
+	for (json_value_ref child = container->v.c.child; child; child = child->next)
+		lj_itemvector_push(&result, arena, pool, child);
+
+	return result;
+}
+
+//
+// containers - private
+//
+
+///
+/// allocates heap memory for a key or string of the specified value - sized
+/// for reuse if the value came from a pool
+///
+static inline char* lj_value_heap_string(json_value_ref value, const size_t size,
+										 lj_pool* pool) {
+	if (value->flags & LJ_VALUE_POOLED)
+		return lj_pool_buffer(pool, size);
+
+	return ljmalloc(size);
+}
+
+///
+/// stores a copy of length bytes of the specified key in the value - inside
+/// of it if the key is short enough, otherwise in memory allocated from the
+/// arena (or the heap if there is none)
+///
+void lj_value_store_key(json_value_ref value, const char* key, const size_t length,
+						lj_arena* arena) {
+	char* target = value->key.inl;
+
+	if (length <= LJ_VALUE_INLINE_KEYMAX)
+		value->flags |= LJ_VALUE_INLINE_KEY;
+	else {
+		target = arena ? lj_arena_alloc(arena, length + 1) :
+						 lj_value_heap_string(value, length + 1, NULL);
+		value->key.ext.ptr = target;
+	}
+
+	memcpy(target, key, length);
+	target[length] = '\0';
+
+	lj_value_store_key_length(value, length);
+}
+
+///
+/// lj_value_store_key counterpart for the contents of string values, which
+/// may also reuse a buffer of the pool
+///
+void lj_value_store_string(json_value_ref value, const char* str, const size_t length,
+						   lj_arena* arena, lj_pool* pool) {
+	char* target = value->v.strI;
+
+	if (length <= LJ_VALUE_INLINE_STRMAX)
+		value->flags |= LJ_VALUE_INLINE_STR;
+	else {
+		target = arena ? lj_arena_alloc(arena, length + 1) :
+						 lj_value_heap_string(value, length + 1, pool);
+		value->v.strV = target;
+	}
+
+	memcpy(target, str, length);
+	target[length] = '\0';
+
+	value->count = (json_index_t)length;
+}
+
+/// releases the key of the specified value, if it owns the memory of it
+void lj_value_release_key(json_value_ref value) {
+	if (!(value->flags & (LJ_VALUE_BORROWED_KEY | LJ_VALUE_INLINE_KEY | LJ_VALUE_IN_ARENA)))
+		free(value->key.ext.ptr);
+
+	value->key.ext.ptr = NULL;
+	value->keyLength = 0;
+	value->flags &= ~(LJ_VALUE_BORROWED_KEY | LJ_VALUE_INLINE_KEY);
+}
+
+///
+/// links the specified value as the last child of the container, keeping its
+/// count, key index and item vector up to date (building them once the
+/// container gets big enough)
+///
+void lj_container_append(json_value_ref container, json_value_ref value,
+						 lj_arena* arena, lj_pool* pool) {
+	json_value_ref previous = container->v.c.last;
+
+	if (container->v.c.last)
+		container->v.c.last->next = value;
+	else
+		container->v.c.child = value;
+
+	container->v.c.last = value;
+	container->count++;
+
+	if (container->type == JSON_TYPE_OBJECT) {
+		if (container->v.c.index.keys)
+			lj_keyindex_insert(&(container->v.c.index.keys), arena, pool, value, previous);
+		else if (container->count > LJ_KEYINDEX_THRESHOLD)
+			container->v.c.index.keys = lj_keyindex_build(container, arena, pool);
+	} else if (container->v.c.index.items)
+		lj_itemvector_push(&(container->v.c.index.items), arena, pool, value);
+	else if (container->count > LJ_ITEMVECTOR_THRESHOLD)
+		container->v.c.index.items = lj_itemvector_build(container, arena, pool);
+}
+
+///
+/// returns the specified value to the pool together with all the buffers it
+/// owns. Children are left alone
+///
+void lj_pool_release_value(lj_pool* pool, json_value_ref value) {
+	const uint8_t flags = value->flags;
+
+	if (!(flags & (LJ_VALUE_BORROWED_KEY | LJ_VALUE_INLINE_KEY)) && value->key.ext.ptr) {
+		if (flags & LJ_VALUE_POOLED)
+			lj_pool_release_buffer(pool, value->key.ext.ptr, LJ_VALUE_KEYLEN(value) + 1);
+		else
+			free(value->key.ext.ptr);
+	}
+
+	if (value->type == JSON_TYPE_STRING &&
+		!(flags & (LJ_VALUE_BORROWED_STR | LJ_VALUE_INLINE_STR)) && value->v.strV) {
+		if (flags & LJ_VALUE_POOLED)
+			lj_pool_release_buffer(pool, value->v.strV, (size_t)value->count + 1);
+		else
+			free(value->v.strV);
+	} else if (value->type == JSON_TYPE_OBJECT)
+		lj_keyindex_release(value->v.c.index.keys, NULL, pool);
+	else if (value->type == JSON_TYPE_ARRAY)
+		lj_itemvector_release(value->v.c.index.items, NULL, pool);
+
+	if (pool->valueCount >= LJ_POOL_VALUEMAX) {
+		free(value);
+		return;
+	}
+
+	value->next = pool->values;
+	pool->values = value;
+	pool->valueCount++;
+}
+
+/// lj_pool_release_value counterpart of json_value_release_tree
+void lj_pool_release_tree(lj_pool* pool, json_value_ref value) {
+	while (value) {
+		json_value_ref next = value->next;
+
+		if ((value->type == JSON_TYPE_ARRAY || value->type == JSON_TYPE_OBJECT) &&
+			value->v.c.child) {
+			// same trick as json_value_release_tree - no recursion
+			value->v.c.last->next = next;
+			next = value->v.c.child;
+		}
+
+		lj_pool_release_value(pool, value);
+		value = next;
+	}
+}
+
+//
+// json_parse - private
+//
+
+///
+/// creates a new instance of the json_error structure with the provided
+/// data being saved
+///
+json_error json_error_make(const json_index_t line,
+						   const json_index_t character,
+						   const char* msgF,
+						   ...) {
+	json_error result = { (msgF ? true : false), line, character, NULL };
+	
+	if (msgF) {
+		// merge the specified error message template with its parameters
+		// into a single string
+		
+		char* msg = calloc(LJ_ERROR_CHARMAX, sizeof(char)); 
+		
+		va_list vl;
+		va_start(vl, msgF);
+		
+		vsprintf(msg, msgF, vl);
+		
+		va_end(vl);
+		
+		result.message = msg;
+	}
+	
+	return result;
+}
+
+/// sets *p1 to p2 if p1 is a valid pointer
+#define LJ_IF_NOT_NULL(p1, p2) \
+{ \
+	if (p1) \
+		(*p1) = p2; \
+}
+
+#define LJ_IS_CONTAINER(obj) (obj->type == JSON_TYPE_ARRAY || \
+							  obj->type == JSON_TYPE_OBJECT)
+
+/// values owned by a json_document can't be modified or released on their own
+#define LJ_IS_READONLY(obj) ((obj->flags & LJ_VALUE_IN_ARENA) != 0)
+
+/// checks if the specified character is JSON whitespace
+#define LJ_IS_JSONSPACE(current) \
+	(current == ' ' || current == '\t' || current == '\n' || current == '\r')
+
+/// locale-independent isdigit
+#define LJ_IS_DIGIT(current) ((current) >= '0' && (current) <= '9')
+
+///
+/// checks if the specified character is a JSON delimiter token (ends the
+/// current scalar just like it does for the structural indexer)
+///
+#define LJ_IS_JSONTOK(current) \
+	(LJ_IS_JSONSPACE(current) || current == ']' || current == '}' || \
+	 current == '[' || current == '{' || current == ',' || current == ':' || \
+	 current == '"')
+
+/// initial depth of the json_parse container stack
+#define LJ_PARSE_STACK_BASE 16
+/// max nesting depth of containers, deeper documents fail to parse
+#ifndef LJ_PARSE_MAX_DEPTH
+#define LJ_PARSE_MAX_DEPTH 1024
+#endif
+
+/// internally-used parsing state machine
+typedef enum {
+	// any value is expected (document root, after ':' or ',' in arrays)
+	JSON_STATE_VALUE = 0,
+
+	// just entered an array - either a value or ']'
+	JSON_STATE_ARRAY_FIRST = 80,
+
+	// just entered an object - either a key or '}'
+	JSON_STATE_OBJECT_FIRST = 90,
+	// key expected after ',' inside an object
+	JSON_STATE_KEY = 91,
+	// ':' expected after a key
+	JSON_STATE_COLON = 92,
+
+	// value finished inside a container - either ',' or its end token
+	JSON_STATE_NEXT = 70,
+	// root value finished, only whitespace may follow
+	JSON_STATE_DONE = 71
+} json_parse_state_t;
+
+/// [json_parse] parsing context shared by all json_parse helpers
+typedef struct {
+	const char* input;
+	size_t length;
+	// offset of the current token
+	size_t index;
+
+	// positions of all tokens worth looking at
+	lj_index structurals;
+	json_parse_state_t state;
+
+	// explicit stack of open container types instead of recursion
+	json_type_t* stack;
+	json_index_t depth;
+	json_index_t stackSize;
+	// nesting depth limit, LJ_PARSE_MAX_DEPTH if zero
+	json_index_t maxDepth;
+
+	// reused buffer for the unescaped forms of strings with escape sequences
+	char* scratch;
+	size_t scratchSize;
+
+	// if set, strings and keys are unescaped in place inside this buffer
+	// (which is the same memory as input)
+	char* insitu;
+
+	// if set, more input may follow after input + length
+	bool partial;
+	// the partial input ended in the middle of the last token
+	bool incomplete;
+	// values are only being skipped, don't bother reading them
+	bool skipping;
+
+	// if set, parsing stops right after the root value
+	bool single;
+	// if set, any amount of root values may follow each other
+	bool multiple;
+	// if set, these root values are separated by commas (like array items)
+	bool commas;
+	// offset right past the last root value
+	size_t end;
+	// location of input[0] in the whole document (partial input only)
+	json_index_t lineOffset;
+	json_index_t charOffset;
+} lj_parser;
+
+/// max amount of significant digits handled by the fast number parsing path
+#define LJ_NUMBER_FASTDIGITS 19
+/// largest integer that a double can hold exactly (2^53)
+#define LJ_NUMBER_EXACTMAX UINT64_C(9007199254740992)
+
+/// powers of ten that a double can hold exactly
+static const double lj_pow10_exact[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+///
+/// slow path of lj_parse_number - hands an already validated number over to
+/// strtod, which rounds correctly, but expects the decimal point of the
+/// current locale instead of '.'
+///
+json_number_t lj_parse_number_slow(const char* input, const size_t length) {
+	const char* point = localeconv()->decimal_point;
+
+	if (!point || point[0] == '\0')
+		point = ".";
+
+	const size_t pointLength = strlen(point);
+
+	char local[LJ_STRINGOPS_NUMMAX * 2];
+	const size_t maxLength = length * pointLength + 1;
+	char* terminated = (maxLength <= sizeof(local)) ? local : ljmalloc(maxLength);
+	size_t resultLength = 0;
+
+	for (size_t i = 0; i < length; i++) {
+		if (input[i] == '.' && pointLength > 1) {
+			memcpy(terminated + resultLength, point, pointLength);
+			resultLength += pointLength;
+		} else
+			terminated[resultLength++] = (input[i] == '.') ? point[0] : input[i];
+	}
+
+	terminated[resultLength] = '\0';
+	const json_number_t result = strtod(terminated, NULL);
+
+	if (terminated != local)
+		free(terminated);
+
+	return result;
+}
+
+///
+/// parses length bytes of input as a JSON number, which must match the strict
+/// JSON number grammar as a whole. Up to LJ_NUMBER_FASTDIGITS significant
+/// digits with a small enough exponent are converted exactly right away, the
+/// rest goes through lj_parse_number_slow. Integers that fit into 64 bits are
+/// also saved to *integerP as is (the kind of them goes to *integralP)
+///
+bool lj_parse_number(const char* input, const size_t length, json_number_t* resultP,
+					 json_integer_t* integralP, uint64_t* integerP) {
+	size_t index = 0;
+	const bool negative = (length > 0 && input[0] == '-');
+
+	if (negative)
+		index++;
+
+	// integer part - either a single zero or no leading zeroes at all
+	if (index >= length || !LJ_IS_DIGIT(input[index]))
+		return false;
+	else if (input[index] == '0' && index + 1 < length && LJ_IS_DIGIT(input[index + 1]))
+		return false;
+
+	const size_t integerStart = index;
+
+	uint64_t mantissa = 0;
+	json_index_t digits = 0;
+	// power of ten the mantissa has to be multiplied with
+	int64_t exponent = 0;
+	// some nonzero digits did not fit into the mantissa
+	bool truncated = false;
+
+	for (; index < length && LJ_IS_DIGIT(input[index]); index++) {
+		if (digits < LJ_NUMBER_FASTDIGITS) {
+			mantissa = mantissa * 10 + (uint64_t)(input[index] - '0');
+			digits += (mantissa != 0);
+		} else {
+			truncated |= (input[index] != '0');
+			exponent++;
+		}
+	}
+
+	const size_t integerDigits = index - integerStart;
+
+	// fraction
+	if (index < length && input[index] == '.') {
+		index++;
+
+		if (index >= length || !LJ_IS_DIGIT(input[index]))
+			return false;
+
+		for (; index < length && LJ_IS_DIGIT(input[index]); index++) {
+			if (digits < LJ_NUMBER_FASTDIGITS) {
+				mantissa = mantissa * 10 + (uint64_t)(input[index] - '0');
+				digits += (mantissa != 0);
+				exponent--;
+			} else
+				truncated |= (input[index] != '0');
+		}
+	}
+
+	// exponent
+	if (index < length && (input[index] == 'e' || input[index] == 'E')) {
+		index++;
+
+		const bool negativeExp = (index < length && input[index] == '-');
+
+		if (index < length && (input[index] == '-' || input[index] == '+'))
+			index++;
+
+		if (index >= length || !LJ_IS_DIGIT(input[index]))
+			return false;
+
+		int64_t explicitExp = 0;
+
+		for (; index < length && LJ_IS_DIGIT(input[index]); index++) {
+			// anything this large over- or underflows anyway
+			if (explicitExp < 100000)
+				explicitExp = explicitExp * 10 + (input[index] - '0');
+		}
+
+		exponent += negativeExp ? -explicitExp : explicitExp;
+	}
+
+	if (index != length)
+		return false; // trailing garbage
+
+	json_number_t result = 0.0;
+	json_integer_t integral = JSON_INTEGER_NONE;
+
+	if (integerDigits == (length - negative)) {
+		// only digits, 20 of them might still fit into uint64_t
+		const uint64_t last = (uint64_t)(input[length - 1] - '0');
+
+		if (integerDigits == LJ_NUMBER_FASTDIGITS + 1 &&
+			mantissa <= (UINT64_MAX - last) / 10) {
+			mantissa = mantissa * 10 + last;
+			truncated = false;
+			exponent = 0;
+		}
+
+		if (!truncated && exponent == 0) {
+			if (!negative)
+				integral = (mantissa <= INT64_MAX) ? JSON_INTEGER_SIGNED : JSON_INTEGER_UNSIGNED;
+			else if (mantissa <= (uint64_t)INT64_MAX + 1)
+				integral = JSON_INTEGER_SIGNED;
+		}
+
+		LJ_IF_NOT_NULL(integerP, negative ? (0 - mantissa) : mantissa)
+	}
+
+	LJ_IF_NOT_NULL(integralP, integral)
+
+	if (mantissa == 0 && !truncated)
+		result = 0.0;
+#if FLT_EVAL_METHOD == 0
+	else if (!truncated && exponent == 0)
+		result = (json_number_t)mantissa; // rounded correctly by the conversion
+	else if (!truncated && mantissa <= LJ_NUMBER_EXACTMAX &&
+			 exponent >= -22 && exponent <= 22) {
+		// both operands are exact, so the single operation rounds correctly
+		if (exponent < 0)
+			result = (json_number_t)mantissa / lj_pow10_exact[-exponent];
+		else
+			result = (json_number_t)mantissa * lj_pow10_exact[exponent];
+	}
+#endif
+	else
+		result = lj_parse_number_slow(input + negative, length - negative);
+
+	LJ_IF_NOT_NULL(resultP, negative ? -result : result)
+	return true;
+}
+
+/// releases the memory used by the parser itself
+void lj_parser_cleanup(lj_parser* p) {
+	free(p->stack);
+	free(p->scratch);
+
+	p->stack = NULL;
+	p->scratch = NULL;
+}
+
+///
+/// converts a byte offset into the input into line/character numbers for
+/// json_error, only ever called on the error path
+///
+void lj_parser_locate(const lj_parser* p, const size_t offset,
+					  json_index_t* lineP, json_index_t* charP) {
+	json_index_t line = 1 + p->lineOffset;
+	size_t lineStart = 0;
+	json_index_t charBase = p->charOffset;
+
+	for (size_t i = 0; i < offset && i < p->length; i++) {
+		if (p->input[i] == '\n') {
+			line++;
+			lineStart = i + 1;
+			charBase = 0;
+		}
+	}
+
+	LJ_IF_NOT_NULL(lineP, line)
+	LJ_IF_NOT_NULL(charP, (json_index_t)(offset - lineStart + 1 + charBase))
+}
+
+/// points the parser at the next piece of input, keeping the parsing state
+void lj_parser_reset_input(lj_parser* p, const char* input, const size_t length) {
+	p->input = input;
+	p->length = length;
+	p->index = 0;
+	p->incomplete = false;
+
+	p->structurals.input = input;
+	p->structurals.length = length;
+	p->structurals.offset = 0;
+	p->structurals.prevEscaped = 0;
+	p->structurals.prevInString = 0;
+	p->structurals.prevScalar = 0;
+	p->structurals.count = 0;
+	p->structurals.cursor = 0;
+	p->structurals.window = 0;
+}
+
+///
+/// moves the location of input[0] past the first consumed bytes of input, so
+/// that errors in the next piece of partial input are reported correctly
+///
+void lj_parser_skip_location(lj_parser* p, const size_t consumed) {
+	for (size_t i = 0; i < consumed; i++) {
+		if (p->input[i] == '\n') {
+			p->lineOffset++;
+			p->charOffset = 0;
+		} else
+			p->charOffset++;
+	}
+}
+
+/// result of lj_parser_read_string
+typedef enum {
+	LJ_STRING_VALID = 0,
+	// the closing doublequote is missing (might follow in partial input)
+	LJ_STRING_UNTERMINATED = 1,
+	// unknown escape sequence, bad \uXXXX digits or an unpaired surrogate
+	LJ_STRING_BAD_ESCAPE = 2,
+	// malformed, overlong or out of range UTF-8 sequence
+	LJ_STRING_BAD_UTF8 = 3,
+	// control character (below 0x20) that is not escaped
+	LJ_STRING_CONTROL = 4
+} lj_string_status_t;
+
+/// returns the character represented by the escape sequence '\\' + current
+char lj_unescape_char(const char current) {
+	switch (current) {
+		case 'b':
+			return '\b';
+		case 'f':
+			return '\f';
+		case 't':
+			return '\t';
+		case 'n':
+			return '\n';
+		case 'r':
+			return '\r';
+		default:
+			return current; // '"', '\\' and '/'
+	}
+}
+
+///
+/// decodes four hex digits into *resultP, returns false if any is not one.
+/// Only the first available digits are looked at if there are less than four
+///
+static inline bool lj_unescape_hex4(const char* input, const size_t available,
+									uint32_t* resultP) {
+	uint32_t result = 0;
+
+	for (json_index_t i = 0; i < 4 && i < available; i++) {
+		const char current = input[i];
+		result <<= 4;
+
+		if (LJ_IS_DIGIT(current))
+			result |= (uint32_t)(current - '0');
+		else if (current >= 'a' && current <= 'f')
+			result |= (uint32_t)(current - 'a' + 10);
+		else if (current >= 'A' && current <= 'F')
+			result |= (uint32_t)(current - 'A' + 10);
+		else
+			return false;
+	}
+
+	(*resultP) = result;
+	return true;
+}
+
+/// writes the UTF-8 form of the specified code point, returns its length
+static inline size_t lj_utf8_encode(const uint32_t codepoint, char* out) {
+	if (codepoint < 0x80) {
+		out[0] = (char)codepoint;
+		return 1;
+	} else if (codepoint < 0x800) {
+		out[0] = (char)(0xC0 | (codepoint >> 6));
+		out[1] = (char)(0x80 | (codepoint & 0x3F));
+		return 2;
+	} else if (codepoint < 0x10000) {
+		out[0] = (char)(0xE0 | (codepoint >> 12));
+		out[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+		out[2] = (char)(0x80 | (codepoint & 0x3F));
+		return 3;
+	}
+
+	out[0] = (char)(0xF0 | (codepoint >> 18));
+	out[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+	out[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+	out[3] = (char)(0x80 | (codepoint & 0x3F));
+	return 4;
+}
+
+///
+/// checks the multibyte UTF-8 sequence at input, returning its length or 0 if
+/// it is invalid. Only the first available bytes are looked at, so a longer
+/// result means the sequence is cut short. Overlong forms, surrogates and
+/// code points past U+10FFFF are rejected, just like RFC 3629 says
+///
+static inline size_t lj_utf8_check(const uint8_t* input, const size_t available) {
+	const uint8_t lead = input[0];
+	size_t length = 0;
+	// allowed range of the second byte, narrower than usual for some leads
+	uint8_t low = 0x80;
+	uint8_t high = 0xBF;
+
+	if (lead >= 0xC2 && lead <= 0xDF)
+		length = 2;
+	else if (lead >= 0xE0 && lead <= 0xEF) {
+		length = 3;
+
+		if (lead == 0xE0)
+			low = 0xA0; // overlong
+		else if (lead == 0xED)
+			high = 0x9F; // surrogates
+	} else if (lead >= 0xF0 && lead <= 0xF4) {
+		length = 4;
+
+		if (lead == 0xF0)
+			low = 0x90; // overlong
+		else if (lead == 0xF4)
+			high = 0x8F; // past U+10FFFF
+	} else
+		return 0; // stray continuation byte, overlong 2-byte form or garbage
+
+	if (available >= 2 && (input[1] < low || input[1] > high))
+		return 0;
+
+	for (size_t i = 2; i < length && i < available; i++) {
+		if ((input[i] & 0xC0) != 0x80)
+			return 0;
+	}
+
+	return length;
+}
+
+///
+/// finds the first doublequote, backslash, control or non-ASCII character of
+/// [input, end), so that plain ASCII runs of strings are both validated and
+/// skipped a block at a time
+///
+static inline const char* lj_string_find_special(const char* input, const char* end) {
+#ifdef LJ_HAVE_X86_SIMD
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i upperBits = _mm_set1_epi8((char)0xE0);
+
+	while ((end - input) >= 16) {
+		const __m128i chunk = _mm_loadu_si128((const __m128i*)input);
+
+		// control characters are the ones with none of the upper three bits set
+		__m128i found = _mm_cmpeq_epi8(_mm_and_si128(chunk, upperBits), _mm_setzero_si128());
+		found = _mm_or_si128(found, _mm_cmpeq_epi8(chunk, quote));
+		found = _mm_or_si128(found, _mm_cmpeq_epi8(chunk, backslash));
+
+		// non-ASCII characters are the ones with the high bit set
+		const uint64_t mask = (uint16_t)(_mm_movemask_epi8(found) | _mm_movemask_epi8(chunk));
+
+		if (mask)
+			return input + lj_ctz64(mask);
+
+		input += 16;
+	}
+#else
+	const uint64_t ones = UINT64_C(0x0101010101010101);
+	const uint64_t highBits = ones * 0x80;
+
+	while ((end - input) >= 8) {
+		uint64_t word;
+		memcpy(&word, input, sizeof(word));
+
+		const uint64_t quote = word ^ (ones * '"');
+		const uint64_t backslash = word ^ (ones * '\\');
+
+		// same trick as lj_escape_find, plus anything with the high bit set
+		if ((word & highBits) ||
+			(((word - ones * 0x20) | (quote - ones) | (backslash - ones)) & ~word & highBits))
+			break; // pinpointed by the loop below
+
+		input += 8;
+	}
+#endif
+
+	while (input < end) {
+		const uint8_t current = (uint8_t)(*input);
+
+		if (current < 0x20 || current >= 0x80 || current == '"' || current == '\\')
+			break;
+
+		input++;
+	}
+
+	return input;
+}
+
+///
+/// unescapes the already validated contents of a string between start and
+/// end into out, which may be the same memory as the input
+///
+void lj_string_unescape(const char* input, size_t index, const size_t end, char* out) {
+	while (index < end) {
+		const char* backslash = memchr(input + index, '\\', end - index);
+		const size_t run = (backslash ? (size_t)(backslash - input) : end) - index;
+
+		memmove(out, input + index, run);
+		out += run;
+		index += run;
+
+		if (index >= end)
+			break;
+		else if (input[index + 1] != 'u') {
+			*(out++) = lj_unescape_char(input[index + 1]);
+			index += 2;
+			continue;
+		}
+
+		uint32_t codepoint = 0;
+		lj_unescape_hex4(input + index + 2, 4, &codepoint);
+		index += 6;
+
+		if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+			// a high surrogate, always followed by a low one by now
+			uint32_t low = 0;
+			lj_unescape_hex4(input + index + 2, 4, &low);
+			index += 6;
+
+			codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+		}
+
+		out += lj_utf8_encode(codepoint, out);
+	}
+}
+
+///
+/// reads the doublequoted string starting at p->index, leaving p->index right
+/// after the closing doublequote. All escape sequences (surrogate pairs too)
+/// are decoded and the contents are checked to be valid UTF-8. Strings
+/// without escape sequences are returned as slices of the input, the rest are
+/// unescaped into p->scratch (or right into the input in insitu mode). On
+/// failure, *problemP is set to the offset of the offending character
+///
+lj_string_status_t lj_parser_read_string(lj_parser* p, const char** resultP,
+										 size_t* lengthP, size_t* problemP) {
+	const char* input = p->input;
+	const size_t start = p->index + 1;
+
+	// first pass - find the closing doublequote, validate everything on the
+	// way and work out the unescaped length
+	size_t index = start;
+	size_t saved = 0;
+
+	while (true) {
+		index = lj_string_find_special(input + index, input + p->length) - input;
+
+		if (index >= p->length)
+			return LJ_STRING_UNTERMINATED;
+
+		const char current = input[index];
+		(*problemP) = index;
+
+		if (current == '"')
+			break;
+		else if ((uint8_t)current < 0x20)
+			return LJ_STRING_CONTROL;
+		else if (current != '\\') {
+			// a multibyte UTF-8 sequence, unless it is cut by the end
+			const size_t available = p->length - index;
+			const size_t length = lj_utf8_check((const uint8_t*)(input + index), available);
+
+			if (!length)
+				return LJ_STRING_BAD_UTF8;
+			else if (length > available)
+				return LJ_STRING_UNTERMINATED;
+
+			index += length;
+			continue;
+		}
+
+		if (index + 1 >= p->length)
+			return LJ_STRING_UNTERMINATED;
+
+		switch (input[index + 1]) {
+			case '"':
+			case '\\':
+			case '/':
+			case 'b':
+			case 'f':
+			case 'n':
+			case 'r':
+			case 't': {
+				index += 2;
+				saved++;
+				continue;
+			}
+			case 'u':
+				break;
+			default:
+				return LJ_STRING_BAD_ESCAPE;
+		}
+
+		// whatever is cut short by the end of input only fails once the
+		// available part of it turns out to be malformed
+		uint32_t codepoint = 0;
+
+		if (!lj_unescape_hex4(input + index + 2, p->length - index - 2, &codepoint))
+			return LJ_STRING_BAD_ESCAPE;
+		else if (index + 6 > p->length)
+			return LJ_STRING_UNTERMINATED;
+		else if (codepoint >= 0xDC00 && codepoint <= 0xDFFF)
+			return LJ_STRING_BAD_ESCAPE;
+		else if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+			// has to be followed by a low surrogate right away
+			uint32_t low = 0xDC00;
+
+			if ((index + 6 < p->length && input[index + 6] != '\\') ||
+				(index + 7 < p->length && input[index + 7] != 'u') ||
+				(index + 8 < p->length &&
+				 !lj_unescape_hex4(input + index + 8, p->length - index - 8, &low)))
+				return LJ_STRING_BAD_ESCAPE;
+			else if (index + 12 > p->length)
+				return LJ_STRING_UNTERMINATED;
+			else if (low < 0xDC00 || low > 0xDFFF)
+				return LJ_STRING_BAD_ESCAPE;
+
+			// 12 bytes of escapes become 4 bytes of UTF-8
+			index += 12;
+			saved += 8;
+			continue;
+		}
+
+		index += 6;
+		saved += 6 - ((codepoint < 0x80) ? 1 : (codepoint < 0x800) ? 2 : 3);
+	}
+
+	const size_t resultLength = (index - start) - saved;
+
+	p->index = index + 1;
+	(*lengthP) = resultLength;
+
+	if (p->insitu) {
+		// the indexer must see this string before it gets modified - if no
+		// positions are buffered, it might have not reached its end yet
+		if (p->structurals.cursor >= p->structurals.count)
+			lj_index_refill(&(p->structurals));
+
+		// the unescaped form is never longer than the escaped one, and the
+		// closing doublequote, at the latest, becomes the terminator
+		if (saved > 0)
+			lj_string_unescape(input, start, index, p->insitu + start);
+
+		p->insitu[start + resultLength] = '\0';
+
+		(*resultP) = p->insitu + start;
+		return LJ_STRING_VALID;
+	} else if (saved < 1) {
+		(*resultP) = input + start; // nothing to unescape
+		return LJ_STRING_VALID;
+	}
+
+	// second pass - copy the contents, unescaping them on the way
+	if (resultLength >= p->scratchSize) {
+		p->scratchSize = resultLength + 1;
+		p->scratch = realloc(p->scratch, p->scratchSize);
+	}
+
+	lj_string_unescape(input, start, index, p->scratch);
+
+	(*resultP) = p->scratch;
+	return LJ_STRING_VALID;
+}
+
+///
+/// finds the end of the unquoted token (number, boolean or null) starting at
+/// p->index and moves p->index past it. Returns false on an embedded NUL
+/// character
+///
+bool lj_parser_read_token(lj_parser* p) {
+	while (p->index < p->length && !LJ_IS_JSONTOK(p->input[p->index])) {
+		if (p->input[p->index] == '\0')
+			return false; // can't be a part of any valid token
+
+		p->index++;
+	}
+
+	return true;
+}
+
+/// enters a container of the specified type, returns false if it is too deep
+bool lj_parser_push(lj_parser* p, const json_type_t type) {
+	if (p->depth >= (p->maxDepth ? p->maxDepth : LJ_PARSE_MAX_DEPTH))
+		return false;
+	else if (p->depth >= p->stackSize) {
+		p->stackSize = p->stackSize ? p->stackSize * 2 : LJ_PARSE_STACK_BASE;
+		p->stack = realloc(p->stack, sizeof(json_type_t) * p->stackSize);
+	}
+
+	p->stack[p->depth++] = type;
+	return true;
+}
+
+/// throws a parsing error at offset
+#define LJ_ERROR(offset, ...) \
+{ \
+	json_index_t lineC = 0; \
+	json_index_t charC = 0; \
+	lj_parser_locate(p, offset, &lineC, &charC); \
+	\
+	LJ_IF_NOT_NULL(errorP, json_error_make(lineC, charC, __VA_ARGS__)) \
+	goto failure; \
+}
+
+/// throws the parsing error matching a lj_parser_read_string failure
+#define LJ_STRING_ERROR(offset, status) \
+	LJ_ERROR(offset, (status == LJ_STRING_BAD_ESCAPE) ? "Invalid escape sequence" : \
+					 (status == LJ_STRING_CONTROL) ? "Unescaped control character in string" : \
+					 "Invalid UTF-8 sequence")
+
+///
+/// [json_parse] reads the next token of the input stored in the specified
+/// parser context into *token (JSON_TOKEN_END once the document is over).
+/// Returns false on a parsing error
+///
+bool lj_parser_next(lj_parser* p, json_token* token, json_error* errorP) {
+	const char* input = p->input;
+
+	if (p->single && p->state == JSON_STATE_DONE) {
+		// leave whatever follows the root value alone
+		token->type = JSON_TOKEN_END;
+		return true;
+	}
+
+	// whitespace never makes it into the structural index, so there is
+	// no need to skip it here
+	while (lj_index_next(&(p->structurals), &(p->index))) {
+		const char current = input[p->index];
+		const json_type_t top = (p->depth >= 1) ? p->stack[p->depth - 1] : JSON_TYPE_NULL;
+
+		token->offset = p->index;
+		token->integral = JSON_INTEGER_NONE;
+
+		if (p->multiple && p->state == JSON_STATE_DONE) {
+			// the next root value starts here (or right after the comma)
+			p->state = JSON_STATE_VALUE;
+
+			if (p->commas && current != ',')
+				LJ_ERROR(p->index, "Expected ',', got '%c' instead", current)
+			else if (p->commas)
+				continue;
+		}
+
+		switch (p->state) {
+			case JSON_STATE_DONE:
+				LJ_ERROR(p->index, "Unexpected '%c' after the end of the document", current)
+			case JSON_STATE_COLON: {
+				if (current != ':')
+					LJ_ERROR(p->index, "Expected ':', got '%c' instead", current)
+
+				p->state = JSON_STATE_VALUE;
+				continue;
+			}
+			case JSON_STATE_OBJECT_FIRST:
+			case JSON_STATE_KEY: {
+				if (current == '}' && p->state == JSON_STATE_OBJECT_FIRST)
+					break; // empty object, closed below
+				else if (current != '"')
+					LJ_ERROR(p->index, "Expected key, got '%c' instead", current)
+
+				token->type = JSON_TOKEN_KEY;
+				token->data = input;
+
+				if (!p->skipping) {
+					size_t problem = 0;
+					const lj_string_status_t status = lj_parser_read_string(p, &(token->data),
+																			&(token->length),
+																			&problem);
+
+					if (status == LJ_STRING_UNTERMINATED && p->partial)
+						goto incomplete;
+					else if (status == LJ_STRING_UNTERMINATED)
+						LJ_ERROR(token->offset, "Unterminated key string")
+					else if (status != LJ_STRING_VALID)
+						LJ_STRING_ERROR(problem, status)
+				}
+
+				p->state = JSON_STATE_COLON;
+				return true;
+			}
+			case JSON_STATE_NEXT: {
+				if (current == ',') {
+					p->state = (top == JSON_TYPE_OBJECT) ? JSON_STATE_KEY : JSON_STATE_VALUE;
+					continue;
+				} else if ((current == '}' && top == JSON_TYPE_OBJECT) ||
+						   (current == ']' && top == JSON_TYPE_ARRAY))
+					break; // closed below
+
+				LJ_ERROR(p->index, "Expected ',' or '%c', got '%c' instead",
+						 (top == JSON_TYPE_OBJECT) ? '}' : ']', current)
+			}
+			case JSON_STATE_ARRAY_FIRST: {
+				if (current == ']')
+					break; // empty array, closed below
+
+				// otherwise this is the first value
+				p->state = JSON_STATE_VALUE;
+			}
+			// fall through
+			case JSON_STATE_VALUE: {
+				if (current == '{' || current == '[') {
+					// looks like we are going deeper and are starting a container
+					const bool object = (current == '{');
+
+					if (!lj_parser_push(p, object ? JSON_TYPE_OBJECT : JSON_TYPE_ARRAY))
+						LJ_ERROR(p->index, "Maximum nesting depth of %u exceeded",
+								 p->maxDepth ? p->maxDepth : LJ_PARSE_MAX_DEPTH)
+
+					token->type = object ? JSON_TOKEN_START_OBJECT : JSON_TOKEN_START_ARRAY;
+					p->state = object ? JSON_STATE_OBJECT_FIRST : JSON_STATE_ARRAY_FIRST;
+					return true;
+				} else if (p->skipping) {
+					// the next structural position lies past this value anyway,
+					// so there is no need to read it
+					token->type = (current == '"') ? JSON_TOKEN_STRING :
+								  (current == 'n') ? JSON_TOKEN_NULL :
+								  (current == 't' || current == 'f') ? JSON_TOKEN_BOOLEAN :
+								  JSON_TOKEN_NUMBER;
+				} else if (current == '"') {
+					token->type = JSON_TOKEN_STRING;
+
+					size_t problem = 0;
+					const lj_string_status_t status = lj_parser_read_string(p, &(token->data),
+																			&(token->length),
+																			&problem);
+
+					if (status == LJ_STRING_UNTERMINATED && p->partial)
+						goto incomplete;
+					else if (status == LJ_STRING_UNTERMINATED)
+						LJ_ERROR(token->offset, "Unterminated string")
+					else if (status != LJ_STRING_VALID)
+						LJ_STRING_ERROR(problem, status)
+				} else {
+					if (!lj_parser_read_token(p) || p->index == token->offset)
+						LJ_ERROR(token->offset, "Expected a valid JSON value, got '%c' token", current)
+					else if (p->index >= p->length && p->partial)
+						goto incomplete; // the next piece of input might continue it
+
+					token->data = input + token->offset;
+					token->length = p->index - token->offset;
+
+					if (token->length == 4 && memcmp(token->data, "null", 4) == 0)
+						token->type = JSON_TOKEN_NULL;
+					else if (token->length == 4 && memcmp(token->data, "true", 4) == 0) {
+						token->type = JSON_TOKEN_BOOLEAN;
+						token->number = true;
+					} else if (token->length == 5 && memcmp(token->data, "false", 5) == 0) {
+						token->type = JSON_TOKEN_BOOLEAN;
+						token->number = false;
+					} else if (lj_parse_number(token->data, token->length, &(token->number),
+											   &(token->integral), &(token->integer.u)))
+						token->type = JSON_TOKEN_NUMBER;
+					else if (current == '-' || LJ_IS_DIGIT(current))
+						LJ_ERROR(token->offset, "Malformed number")
+					else
+						LJ_ERROR(token->offset, "Expected a valid JSON value, got '%c' token", current)
+				}
+
+				p->state = (p->depth >= 1) ? JSON_STATE_NEXT : JSON_STATE_DONE;
+				p->end = p->index;
+				return true;
+			}
+		}
+
+		// the only way to get here is by closing the innermost container
+		p->depth--;
+
+		token->type = (top == JSON_TYPE_OBJECT) ? JSON_TOKEN_END_OBJECT : JSON_TOKEN_END_ARRAY;
+		p->state = (p->depth >= 1) ? JSON_STATE_NEXT : JSON_STATE_DONE;
+		p->end = p->index + 1;
+		return true;
+	}
+
+	// a batch may hold no documents at all, unlike a single document
+	const bool empty = (p->multiple && p->state == JSON_STATE_VALUE &&
+						p->depth < 1 && p->end < 1);
+
+	if (p->state != JSON_STATE_DONE && !p->partial && !empty)
+		LJ_ERROR(p->length, "Unexpected end of document")
+
+	token->type = JSON_TOKEN_END;
+	return true;
+
+incomplete:
+	// the caller has to come back with more input starting at token->offset
+	p->incomplete = true;
+	token->type = JSON_TOKEN_END;
+	return true;
+
+failure:
+	return false;
+}
+
+///
+/// skips the next value (or the next key together with its value) with all
+/// of its children. Containers are skipped just by balancing their brackets
+/// in the structural index, so their contents are not validated. *token is
+/// set to the first token of the skipped value, or the end of the container
+///
+bool lj_parser_skip(lj_parser* p, json_token* token, json_error* errorP) {
+	p->skipping = true;
+	bool result = lj_parser_next(p, token, errorP);
+
+	if (result && token->type == JSON_TOKEN_KEY)
+		result = lj_parser_next(p, token, errorP);
+
+	p->skipping = false;
+
+	if (!result || (token->type != JSON_TOKEN_START_OBJECT &&
+					token->type != JSON_TOKEN_START_ARRAY))
+		return result;
+
+	// fast-forward to the matching end of the container
+	json_index_t nesting = 1;
+
+	while (lj_index_next(&(p->structurals), &(p->index))) {
+		const char current = p->input[p->index];
+
+		if (current == '{' || current == '[')
+			nesting++;
+		else if ((current == '}' || current == ']') && --nesting < 1) {
+			const json_type_t top = p->stack[--(p->depth)];
+
+			if ((current == '}') != (top == JSON_TYPE_OBJECT))
+				LJ_ERROR(p->index, "Expected '%c', got '%c' instead",
+						 (top == JSON_TYPE_OBJECT) ? '}' : ']', current)
+
+			p->state = (p->depth >= 1) ? JSON_STATE_NEXT : JSON_STATE_DONE;
+			return true;
+		}
+	}
+
+	LJ_ERROR(p->length, "Unexpected end of document")
+
+failure:
+	return false;
+}
+
+/// passes the specified token to the matching handler callback
+bool lj_parser_dispatch(const json_token* token, const json_handler* handler,
+						void* context) {
+	switch (token->type) {
+		case JSON_TOKEN_START_OBJECT:
+			return !handler->start_object || handler->start_object(context);
+		case JSON_TOKEN_END_OBJECT:
+			return !handler->end_object || handler->end_object(context);
+		case JSON_TOKEN_START_ARRAY:
+			return !handler->start_array || handler->start_array(context);
+		case JSON_TOKEN_END_ARRAY:
+			return !handler->end_array || handler->end_array(context);
+		case JSON_TOKEN_KEY:
+			return !handler->key || handler->key(context, token->data, token->length);
+		case JSON_TOKEN_STRING:
+			return !handler->string || handler->string(context, token->data, token->length);
+		case JSON_TOKEN_NUMBER: {
+			if (token->integral == JSON_INTEGER_SIGNED && handler->int64)
+				return handler->int64(context, token->integer.i, token->data, token->length);
+			else if (token->integral == JSON_INTEGER_UNSIGNED && handler->uint64)
+				return handler->uint64(context, token->integer.u, token->data, token->length);
+
+			return !handler->number || handler->number(context, token->number,
+													   token->data, token->length);
+		}
+		case JSON_TOKEN_BOOLEAN:
+			return !handler->boolean || handler->boolean(context, token->number != 0);
+		case JSON_TOKEN_NULL:
+			return !handler->null || handler->null(context);
+		default:
+			return true;
+	}
+}
+
+///
+/// fires the matching handler callback for every token of the input stored
+/// in the specified parser context. On success, *consumedP is set to the
+/// amount of input bytes that were fully parsed - anything past it is the
+/// start of an incomplete token (partial input only)
+///
+bool lj_parser_run(lj_parser* p, const json_handler* handler, void* context,
+				   size_t* consumedP, json_error* errorP) {
+	json_token token;
+
+	while (lj_parser_next(p, &token, errorP)) {
+		if (token.type == JSON_TOKEN_END) {
+			(*consumedP) = p->incomplete ? token.offset : p->length;
+			return true;
+		} else if (!lj_parser_dispatch(&token, handler, context))
+			LJ_ERROR(token.offset, "Parsing stopped by the handler")
+	}
+
+failure:
+	return false;
+}
+
+///
+/// [json_parse_events] parses the input stored in the specified parser
+/// context, firing the matching handler callback for every single token
+///
+bool lj_parse_events(lj_parser* p, const json_handler* handler, void* context,
+					 json_error* errorP) {
+	// success boilerplate saved for the future
+	LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, NULL))
+
+	ljprintf("parsing %zu bytes", p->length);
+	lj_parser_reset_input(p, p->input, p->length);
+
+	size_t consumed = 0;
+	return lj_parser_run(p, handler, context, &consumed, errorP);
+}
+
+/// [json_parse] json_parse_events context that builds the value tree
+typedef struct {
+	// root container object
+	json_value_ref root;
+	// innermost open container
+	json_value_ref current;
+	// key that might be set for the next found value - either a pointer into
+	// the insitu-parsed input, keyBuffer or a long key allocated on its own
+	char* futureKey;
+	size_t futureKeyLength;
+	char keyBuffer[LJ_VALUE_INLINE_KEYMAX + 1];
+
+	// containers enclosing the current one (values might have no parent)
+	json_value_ref* stack;
+	json_index_t depth;
+	json_index_t stackSize;
+
+	// if set, all values and strings are allocated from it
+	lj_arena* arena;
+	// if set, values and strings are taken from it instead (json_parser)
+	lj_pool* pool;
+	// if set, strings and keys point into the insitu-parsed input
+	bool insitu;
+} lj_builder;
+
+/// allocates zeroed memory for a parsed value or string
+void* lj_builder_alloc(lj_builder* b, const size_t size) {
+	if (b->arena)
+		return lj_arena_alloc(b->arena, size);
+
+	return ljmalloc(size);
+}
+
+/// copies length bytes of a parsed string into a NUL-terminated one
+char* lj_builder_strndup(lj_builder* b, const char* input, const size_t length) {
+	char* result = b->pool ? lj_pool_buffer(b->pool, length + 1) :
+							 lj_builder_alloc(b, length + 1);
+
+	memcpy(result, input, length);
+	result[length] = '\0';
+
+	return result;
+}
+
+/// makes a new value and links it into the innermost open container
+json_value_ref lj_builder_add(lj_builder* b, const json_type_t type) {
+	json_value_ref value = b->pool ? lj_pool_value(b->pool) :
+									 lj_builder_alloc(b, sizeof(struct json_value_s));
+	value->type = type;
+
+	if (b->arena)
+		value->flags |= LJ_VALUE_IN_ARENA;
+
+	if (!b->current) {
+		b->root = value;
+		return value;
+	}
+
+#ifdef LJ_VALUE_PARENT
+	value->parent = b->current;
+#endif
+
+	if (b->current->type == JSON_TYPE_OBJECT) {
+		const size_t length = b->futureKeyLength;
+
+		if (!b->insitu && length <= LJ_VALUE_INLINE_KEYMAX) {
+			memcpy(value->key.inl, b->futureKey, length + 1);
+			value->flags |= LJ_VALUE_INLINE_KEY;
+		} else {
+			value->key.ext.ptr = b->futureKey;
+
+			if (b->insitu)
+				value->flags |= LJ_VALUE_BORROWED_KEY;
+		}
+
+		lj_value_store_key_length(value, length);
+		b->futureKey = NULL;
+	}
+
+	lj_container_append(b->current, value, b->arena, b->pool);
+	return value;
+}
+
+/// makes a new container and enters it
+void lj_builder_push(lj_builder* b, const json_type_t type) {
+	json_value_ref container = lj_builder_add(b, type);
+
+	if (b->depth >= b->stackSize) {
+		b->stackSize = b->stackSize ? b->stackSize * 2 : LJ_PARSE_STACK_BASE;
+		b->stack = realloc(b->stack, sizeof(json_value_ref) * b->stackSize);
+	}
+
+	b->stack[b->depth++] = b->current;
+	b->current = container;
+}
+
+bool lj_builder_start_object(void* context) {
+	lj_builder_push(context, JSON_TYPE_OBJECT);
+	return true;
+}
+
+bool lj_builder_start_array(void* context) {
+	lj_builder_push(context, JSON_TYPE_ARRAY);
+	return true;
+}
+
+bool lj_builder_end_container(void* context) {
+	lj_builder* b = context;
+	b->current = b->stack[--(b->depth)];
+
+	return true;
+}
+
+bool lj_builder_key(void* context, const char* key, const size_t length) {
+	lj_builder* b = context;
+	b->futureKeyLength = length;
+
+	if (b->insitu)
+		b->futureKey = (char*)key;
+	else if (length <= LJ_VALUE_INLINE_KEYMAX) {
+		// copied into the value itself later on
+		memcpy(b->keyBuffer, key, length);
+		b->keyBuffer[length] = '\0';
+
+		b->futureKey = b->keyBuffer;
+	} else
+		b->futureKey = lj_builder_strndup(b, key, length);
+
+	return true;
+}
+
+bool lj_builder_string(void* context, const char* str, const size_t length) {
+	lj_builder* b = context;
+	json_value_ref value = lj_builder_add(b, JSON_TYPE_STRING);
+
+	if (b->insitu) {
+		value->v.strV = (char*)str;
+		value->count = (json_index_t)length;
+		value->flags |= LJ_VALUE_BORROWED_STR;
+	} else
+		lj_value_store_string(value, str, length, b->arena, b->pool);
+
+	return true;
+}
+
+bool lj_builder_number(void* context, const json_number_t num,
+					   const char* repr, const size_t length) {
+	lj_builder* b = context;
+	json_value_ref value = lj_builder_add(b, JSON_TYPE_NUMBER);
+
+	(void)(repr);
+	(void)(length);
+
+	value->v.numV = num;
+	return true;
+}
+
+bool lj_builder_int64(void* context, const int64_t num,
+					  const char* repr, const size_t length) {
+	lj_builder* b = context;
+	json_value_ref value = lj_builder_add(b, JSON_TYPE_NUMBER);
+
+	(void)(length);
+
+	if (num == 0 && repr[0] == '-') {
+		// only a double can keep the sign of -0
+		value->v.numV = -0.0;
+		return true;
+	}
+
+	value->v.intV = num;
+	value->flags |= LJ_VALUE_INT64;
+	return true;
+}
+
+bool lj_builder_uint64(void* context, const uint64_t num,
+					   const char* repr, const size_t length) {
+	lj_builder* b = context;
+	json_value_ref value = lj_builder_add(b, JSON_TYPE_NUMBER);
+
+	(void)(repr);
+	(void)(length);
+
+	value->v.uintV = num;
+	value->flags |= LJ_VALUE_UINT64;
+	return true;
+}
+
+bool lj_builder_boolean(void* context, const bool bv) {
+	lj_builder* b = context;
+	json_value_ref value = lj_builder_add(b, JSON_TYPE_BOOLEAN);
+
+	value->v.boolV = bv;
+	return true;
+}
+
+bool lj_builder_null(void* context) {
+	lj_builder_add(context, JSON_TYPE_NULL);
+	return true;
+}
+
+/// releases the memory used by the builder itself, but not the tree
+void lj_builder_cleanup(lj_builder* b) {
+	free(b->stack);
+
+	b->stack = NULL;
+	b->depth = 0;
+	b->stackSize = 0;
+}
+
+/// releases everything built so far after a parsing error
+void lj_builder_discard(lj_builder* b) {
+	if (!b->insitu && !b->arena && b->futureKey && b->futureKey != b->keyBuffer) {
+		if (b->pool)
+			lj_pool_release_buffer(b->pool, b->futureKey, b->futureKeyLength + 1);
+		else
+			free(b->futureKey);
+	}
+
+	// arena-allocated values are released together with their arena
+	if (b->pool)
+		lj_pool_release_tree(b->pool, b->root);
+	else if (!b->arena)
+		json_value_release_tree(b->root);
+
+	b->root = NULL;
+	b->current = NULL;
+	b->futureKey = NULL;
+
+	lj_builder_cleanup(b);
+}
+
+/// [json_parse] json_parse_events callbacks that build the value tree
+static const json_handler lj_builder_handler = {
+	.start_object = lj_builder_start_object,
+	.end_object = lj_builder_end_container,
+	.start_array = lj_builder_start_array,
+	.end_array = lj_builder_end_container,
+	.key = lj_builder_key,
+	.string = lj_builder_string,
+	.number = lj_builder_number,
+	.int64 = lj_builder_int64,
+	.uint64 = lj_builder_uint64,
+	.boolean = lj_builder_boolean,
+	.null = lj_builder_null
+};
+
+///
+/// [json_parse] parses the input stored in the specified parser context into
+/// a value tree (allocated from arena or taken from pool, if set) and returns
+/// its root value
+///
+json_value_ref lj_parse(lj_parser* p, lj_arena* arena, lj_pool* pool,
+						json_error* errorP) {
+	lj_builder b = { .arena = arena, .pool = pool, .insitu = (p->insitu != NULL) };
+
+	if (pool) {
+		// pick up the work buffers of the previous parse
+		p->stack = pool->parseStack;
+		p->stackSize = pool->parseStackSize;
+		p->scratch = pool->scratch;
+		p->scratchSize = pool->scratchSize;
+
+		b.stack = pool->buildStack;
+		b.stackSize = pool->buildStackSize;
+	}
+
+	if (p->multiple) {
+		// all root values become items of a single array
+		b.root = b.current = lj_builder_add(&b, JSON_TYPE_ARRAY);
+	}
+
+	const bool success = lj_parse_events(p, &lj_builder_handler, &b, errorP);
+
+	if (pool) {
+		// and leave them for the next one
+		pool->parseStack = p->stack;
+		pool->parseStackSize = p->stackSize;
+		pool->scratch = p->scratch;
+		pool->scratchSize = p->scratchSize;
+
+		pool->buildStack = b.stack;
+		pool->buildStackSize = b.stackSize;
+
+		p->stack = NULL;
+		p->scratch = NULL;
+		b.stack = NULL;
+	}
+
+	lj_parser_cleanup(p);
+
+	if (success) {
+		lj_builder_cleanup(&b);
+		return b.root;
+	}
+
+	lj_builder_discard(&b);
+	return NULL;
+}
+
+//
+// json_parse - public
+//
+
+void json_value_dump_tree(json_value_ref value, const json_index_t offset) {
+	if (!value) {
+		fprintf(stderr, "(null value)\n");
+		return;
+	}
+
+	json_index_t indent = offset;
+
+	// siblings to come back to once the children of a container are done
+	json_value_ref* resume = NULL;
+	json_index_t depth = 0;
+	json_index_t resumeSize = 0;
+
+	while (value) {
+		// type out the correct amount of spaces
+		for (json_index_t i = 0; i < indent; i++)
+			fprintf(stderr, "%c", ' ');
+
+
+		fprintf(stderr, "%s%p%s ", LJ_PRINTF_ADDRESS, value, LJ_PRINTF_RESET);
+
+		if (LJ_VALUE_KEY(value))
+			fprintf(stderr, "key = \"%s\", ", LJ_VALUE_KEY(value));
+		else
+			fprintf(stderr, "no key, ");
+
+		fprintf(stderr, "type = %u, container = %s, ", value->type,
+				LJ_IS_CONTAINER(value) ? "true" : "false");
+
+		if (value->type == JSON_TYPE_STRING)
+			fprintf(stderr, "strV = \"%s\"\n", LJ_VALUE_STR(value));
+		else if (value->type == JSON_TYPE_NUMBER || value->type == JSON_TYPE_BOOLEAN)
+			fprintf(stderr, "numV = %f\n", json_value_get_number(value));
+		else
+			fprintf(stderr, "count = %u\n", value->count);
+
+#ifdef LJ_VALUE_PARENT
+		for (json_index_t i = 0; i < indent; i++)
+			fprintf(stderr, "%c", ' ');
+
+		fprintf(stderr, "(parent = %p)\n", (void*)(value->parent));
+#endif
+
+		if (LJ_IS_CONTAINER(value) && value->v.c.child) {
+			if (depth >= resumeSize) {
+				resumeSize = resumeSize ? resumeSize * 2 : LJ_PARSE_STACK_BASE;
+				resume = realloc(resume, sizeof(json_value_ref) * resumeSize);
+			}
+
+			resume[depth++] = value->next;
+			value = value->v.c.child;
+			indent++;
+			continue;
+		}
+
+		value = value->next;
+
+		while (!value && depth > 0) {
+			value = resume[--depth];
+			indent--;
+		}
+	}
+
+	free(resume);
+}
+
+json_value_ref json_parse(const char* input, json_error* errorP) {
+	return json_parse_n(input, input ? strlen(input) : 0, errorP);
+}
+
+json_value_ref json_parse_n(const char* input, const size_t length,
+							json_error* errorP) {
+	if (!input || length < 1) {
+		// don't bother parsing empty strings
+
+		LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, "NULL or empty string provided as input"));
+		return NULL;
+	}
+
+	lj_parser p = { .input = input, .length = length };
+	return lj_parse(&p, NULL, NULL, errorP);
+}
+
+json_value_ref json_parse_insitu(char* buffer, const size_t length,
+								 json_error* errorP) {
+	if (!buffer || length < 1) {
+		LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, "NULL or empty string provided as input"));
+		return NULL;
+	}
+
+	lj_parser p = { .input = buffer, .length = length, .insitu = buffer };
+	return lj_parse(&p, NULL, NULL, errorP);
+}
+
+json_value_ref json_parse_next(const char* input, const size_t length,
+							   size_t* consumedP, json_error* errorP) {
+	LJ_IF_NOT_NULL(consumedP, 0)
+
+	if (!input || length < 1) {
+		LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, "NULL or empty string provided as input"));
+		return NULL;
+	}
+
+	lj_parser p = { .input = input, .length = length, .single = true };
+	json_value_ref result = lj_parse(&p, NULL, NULL, errorP);
+
+	if (result) {
+		// let the next call start right at the next document
+		size_t end = p.end;
+
+		while (end < length && LJ_IS_JSONSPACE(input[end]))
+			end++;
+
+		LJ_IF_NOT_NULL(consumedP, end)
+	}
+
+	return result;
+}
+
+json_value_ref json_parse_batch(const char* input, const size_t length,
+								json_error* errorP) {
+	if (!input) {
+		LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, "NULL string provided as input"));
+		return NULL;
+	}
+
+	lj_parser p = { .input = input, .length = length, .multiple = true };
+	return lj_parse(&p, NULL, NULL, errorP);
+}
+
+bool json_parse_events(const char* input, const size_t length,
+					   const json_handler* handler, void* context,
+					   json_error* errorP) {
+	if (!input || length < 1 || !handler) {
+		LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, "NULL or empty input or no handler provided"));
+		return false;
+	}
+
+	lj_parser p = { .input = input, .length = length };
+	const bool result = lj_parse_events(&p, handler, context, errorP);
+
+	lj_parser_cleanup(&p);
+	return result;
+}
+
+// undef all json_parse-related macros so that they won't be used in
+// other methods by accident
+#undef LJ_ERROR
+
+//
+// json_parser - public
+//
+
+struct json_parser_s {
+	// released values and strings waiting to be reused
+	lj_pool pool;
+};
+
+json_parser_ref json_parser_new(void) {
+	return ljmalloc_s(json_parser_s);
+}
+
+json_value_ref json_parse_ctx(json_parser_ref parser, const char* input,
+							  const size_t length, json_error* errorP) {
+	if (!parser || !input || length < 1) {
+		LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, "NULL parser or empty string provided as input"));
+		return NULL;
+	}
+
+	lj_parser p = { .input = input, .length = length };
+	return lj_parse(&p, NULL, &(parser->pool), errorP);
+}
+
+void json_parser_release_tree(json_parser_ref parser, json_value_ref value) {
+	if (!parser || !value)
+		return;
+	else if (LJ_IS_READONLY(value)) {
+		ljprintf("value <%p> belongs to a document, use json_document_release", value);
+		return;
+	}
+
+	ljprintf("value <%p> type = %u returned to parser <%p>", value, value->type, parser);
+	lj_pool_release_tree(&(parser->pool), value);
+}
+
+void json_parser_release(json_parser_ref parser) {
+	if (!parser)
+		return;
+
+	lj_pool_cleanup(&(parser->pool));
+	free(parser);
+}
+
+//
+// json_document - public
+//
+
+struct json_document_s {
+	// every value and string of the document is allocated from here
+	lj_arena arena;
+	
+	// root container object
+	json_value_ref root;
+};
+
+///
+/// [json_document] parses the specified input into a new document, in place
+/// if insitu is set (insitu is the same memory as input in that case)
+///
+json_document_ref lj_document_parse(const char* input, char* insitu,
+									const size_t length, const bool multiple,
+									json_error* errorP) {
+	if (!input || (length < 1 && !multiple)) {
+		// an empty batch is just an empty array though
+		LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, "NULL or empty string provided as input"));
+		return NULL;
+	}
+	
+	json_document_ref document = ljmalloc_s(json_document_s);
+	
+	lj_parser p = { .input = input, .length = length, .insitu = insitu,
+					.multiple = multiple };
+	document->root = lj_parse(&p, &(document->arena), NULL, errorP);
+	
+	if (!document->root) {
+		// parsing failed, the partially built tree goes away with the arena
+		json_document_release(document);
+		return NULL;
+	}
+	
+	return document;
+}
+
+json_document_ref json_document_parse(const char* input, const size_t length,
+									  json_error* errorP) {
+	return lj_document_parse(input, NULL, length, false, errorP);
+}
+
+json_document_ref json_document_parse_insitu(char* buffer, const size_t length,
+											 json_error* errorP) {
+	return lj_document_parse(buffer, buffer, length, false, errorP);
+}
+
+json_document_ref json_document_parse_batch(const char* input, const size_t length,
+											json_error* errorP) {
+	return lj_document_parse(input, NULL, length, true, errorP);
+}
+
+json_value_ref json_document_get_root(const json_document_ref document) {
+	return (document ? document->root : NULL);
+}
+
+void json_document_release(json_document_ref document) {
+	if (!document)
+		return;
 	
-	// success boilerplate saved for the future
-	LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, NULL))
-	
-	// for detailed parsing error reporting
-	json_index_t lineC = 1;
-	json_index_t charC = 0;
-	
-	// state machine
-	json_parse_state_t state = JSON_STATE_OUTSIDE;
-	// current value object
-	json_value_ref value = NULL;
+	ljprintf("document <%p> awaiting release", document);
 	
-	// root container object
-	json_value_ref root = NULL;
+	lj_arena_release(&(document->arena));
+	free(document);
+}
+
+//
+// parallel parsing - private
+//
+
+/// inputs shorter than this are never worth splitting between threads
+#define LJ_PARALLEL_MIN 1048576
+/// smallest piece of input handed to a single parallel parsing worker
+#define LJ_PARALLEL_CHUNKMIN 262144
+/// amount of pieces per worker thread, so that uneven ones balance out
+#define LJ_PARALLEL_CHUNKS_PER_THREAD 4
+
+#if !defined(LJ_NO_THREADS) && (defined(__unix__) || defined(__APPLE__))
+#define LJ_HAVE_THREADS 1
+
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/// [json_document_parse_parallel] piece of input parsed by a single worker
+typedef struct {
+	size_t start;
+	size_t end;
 	
-	// key that might be set for the next found value
-	char* futureKey = NULL;
+	// every value of this piece is allocated from here
+	lj_arena arena;
+	// array holding all the values of this piece, NULL on failure
+	json_value_ref values;
+} lj_parallel_chunk;
+
+/// [json_document_parse_parallel] state shared by all the workers
+typedef struct {
+	const char* input;
+	// pieces are comma-separated array items instead of whole documents
+	bool commas;
 	
-	for (json_index_t index = 0; index < strlen(input); index++) {
-		const char current = input[index];
-		charC++;
+	lj_parallel_chunk* chunks;
+	json_index_t count;
+	
+#ifdef LJ_HAVE_THREADS
+	// guards next
+	pthread_mutex_t lock;
+#endif
+	// next piece nobody has taken yet
+	json_index_t next;
+} lj_parallel_job;
+
+///
+/// single-threaded pre-scan of the structural index that splits the input into
+/// up to count pieces at safe points - between the items of the top-level
+/// array or between whole documents. Returns the amount of pieces, or 0 if
+/// the input isn't shaped as expected (it is then left for the regular
+/// parser to report the error)
+///
+json_index_t lj_parallel_split(const char* input, const size_t length,
+							   const bool array, lj_parallel_chunk* chunks,
+							   const json_index_t count) {
+	lj_index ix = { .input = input, .length = length };
+	
+	const size_t step = length / count;
+	size_t target = step;
 	
-		// skip all spaces as we aren't interested in them
-		if (isspace(current) != 0) {
-			if (current == '\n') {
-				// update line/character counters accordingly
+	size_t position = 0;
+	json_index_t depth = 0;
+	json_index_t found = 0;
+	bool started = false;
+	
+	while (lj_index_next(&ix, &position)) {
+		const char current = input[position];
+		
+		if (current == '{' || current == '[') {
+			if (array && depth == 0) {
+				if (started || current != '[')
+					return 0; // not a lone array
 				
-				lineC++;
-				charC = 0;
+				chunks[0].start = position + 1;
+				started = true;
+			} else if (!array && depth == 0 && !started) {
+				chunks[0].start = position;
+				started = true;
+			} else if (!array && depth == 0 && position >= target && (found + 1) < count) {
+				chunks[found++].end = position;
+				chunks[found].start = position;
+				target = position + step;
+			}
+			
+			depth++;
+		} else if (current == '}' || current == ']') {
+			if (depth < 1)
+				return 0;
+			else if (--depth == 0 && array)
+				chunks[found++].end = position;
+		} else if (array) {
+			if (depth == 0)
+				return 0; // a scalar root or something after the array
+			else if (depth == 1 && current == ',' && position >= target && (found + 1) < count) {
+				chunks[found++].end = position;
+				chunks[found].start = position + 1;
+				target = position + step;
+			}
+		} else if (depth == 0) {
+			// a new document starts here
+			if (!started) {
+				chunks[0].start = position;
+				started = true;
+			} else if (position >= target && (found + 1) < count) {
+				chunks[found++].end = position;
+				chunks[found].start = position;
+				target = position + step;
 			}
-		
-			continue;
 		}
+	}
+	
+	if (!started || depth > 0)
+		return 0;
+	else if (!array)
+		chunks[found++].end = length;
+	
+	return found;
+}
+
+/// parallel parsing worker, parses pieces until there are none left
+void* lj_parallel_worker(void* context) {
+	lj_parallel_job* job = context;
+	
+	while (true) {
+#ifdef LJ_HAVE_THREADS
+		pthread_mutex_lock(&(job->lock));
+#endif
+		const json_index_t index = job->next++;
+#ifdef LJ_HAVE_THREADS
+		pthread_mutex_unlock(&(job->lock));
+#endif
 		
-		ljprintf("current = '%c', index = %u", current, index);
+		if (index >= job->count)
+			return NULL;
 		
-		if (state != JSON_STATE_KEY) {
-			if (current == '{') {
-				// looks like we are going deeper and are starting an object
-				ljprintf("handled: new object {} (state = %u)", state);
-				
-				LJ_INIT_EMPTY_OBJ(newObj)
-			
-				newObj->type = JSON_TYPE_OBJECT;
-				newObj->parent = value;
-			
-				// adapt parent attributes correctly
-				LJ_ADAPT_OBJ_PARENT(newObj)
-				value = newObj;
-			
-				ljprintf("state change -> key (new object)");
-				state = JSON_STATE_KEY;
+		lj_parallel_chunk* chunk = &(job->chunks[index]);
+		// items of a root array are one level deeper than the pieces
+		lj_parser p = { .input = job->input + chunk->start,
+						.length = chunk->end - chunk->start,
+						.multiple = true, .commas = job->commas,
+						.maxDepth = LJ_PARSE_MAX_DEPTH - (job->commas ? 1 : 0) };
+		
+		// errors are reported by the single-threaded parser later on
+		chunk->values = lj_parse(&p, &(chunk->arena), NULL, NULL);
+	}
+}
+
+/// picks the amount of worker threads to use if the caller didn't
+json_index_t lj_parallel_threads(const json_index_t threads) {
+	if (threads > 0)
+		return threads;
+	
+#if defined(LJ_HAVE_THREADS) && defined(_SC_NPROCESSORS_ONLN)
+	const long online = sysconf(_SC_NPROCESSORS_ONLN);
+	return (online > 0) ? (json_index_t)online : 1;
+#else
+	return 1;
+#endif
+}
+
+///
+/// [json_document_parse_parallel] splits the input into pieces, parses them on
+/// worker threads and stitches the results together into a single array.
+/// Returns NULL if that didn't work out for any reason
+///
+json_document_ref lj_document_parse_parallel(const char* input, const size_t length,
+											 const bool array, json_index_t threads) {
+	threads = lj_parallel_threads(threads);
+	
+	json_index_t count = threads * LJ_PARALLEL_CHUNKS_PER_THREAD;
+	
+	if (count > (length / LJ_PARALLEL_CHUNKMIN))
+		count = (json_index_t)(length / LJ_PARALLEL_CHUNKMIN);
+	
+	if (threads < 2 || count < 2 || length < LJ_PARALLEL_MIN)
+		return NULL; // not worth it
+	
+	lj_parallel_job job = { .input = input, .commas = array };
+	job.chunks = calloc(count, sizeof(lj_parallel_chunk));
+	job.count = lj_parallel_split(input, length, array, job.chunks, count);
+	
+	if (threads > job.count)
+		threads = job.count;
+	
+	ljprintf("parsing %zu bytes as %u pieces on %u threads", length, job.count, threads);
+	
+	// the calling thread is one of the workers too
+#ifdef LJ_HAVE_THREADS
+	pthread_t* workers = calloc(threads, sizeof(pthread_t));
+	json_index_t started = 0;
+	
+	pthread_mutex_init(&(job.lock), NULL);
+	
+	while ((started + 1) < threads &&
+		   pthread_create(&(workers[started]), NULL, lj_parallel_worker, &job) == 0)
+		started++;
+	
+	lj_parallel_worker(&job);
+	
+	for (json_index_t i = 0; i < started; i++)
+		pthread_join(workers[i], NULL);
+	
+	pthread_mutex_destroy(&(job.lock));
+	free(workers);
+#else
+	lj_parallel_worker(&job);
+#endif
+	
+	// stitch all the pieces together into a single array
+	json_document_ref document = ljmalloc_s(json_document_s);
+	json_value_ref root = lj_arena_alloc(&(document->arena), sizeof(struct json_value_s));
+	
+	root->type = JSON_TYPE_ARRAY;
+	root->flags |= LJ_VALUE_IN_ARENA;
+	
+	bool success = (job.count > 0);
+	
+	for (json_index_t i = 0; i < job.count; i++) {
+		json_value_ref values = job.chunks[i].values;
+		
+		if (!values)
+			success = false;
+		else if (success && values->v.c.child) {
+			if (root->v.c.last)
+				root->v.c.last->next = values->v.c.child;
+			else
+				root->v.c.child = values->v.c.child;
 			
-				ljprintf("%s enter new object from %p to %p %s", 
-						 LJ_PRINTF_GREEN, value->parent, value, LJ_PRINTF_RESET);
-				continue;
-			} else if (current == '[') {
-				ljprintf("handled: new array [] (state = %u)", state);
-				
-				LJ_INIT_EMPTY_OBJ(newObj)
-				
-				newObj->type = JSON_TYPE_ARRAY;
-				
-				// adapt parent attributes correctly
-				LJ_ADAPT_OBJ_PARENT(newObj)
-				value = newObj;
-				
-				ljprintf("state change -> array (new array)");
-				state = JSON_STATE_ARRAY;
-				
-				ljprintf("%s enter new array from %p to %p %s", 
-						 LJ_PRINTF_GREEN, value->parent, value, LJ_PRINTF_RESET);
-				continue;
-			}
+			root->v.c.last = values->v.c.last;
+			root->count += values->count;
 		}
 		
-		if (state == JSON_STATE_OUTSIDE) {
-			ljprintf("handled: outside");
+		// the document owns all the memory of the pieces from now on
+		lj_arena_adopt(&(document->arena), &(job.chunks[i].arena));
+	}
+	
+	free(job.chunks);
+	
+	if (!success) {
+		json_document_release(document);
+		return NULL;
+	}
+	
+	// every item needs its actual parent, and big arrays need their vector
+	lj_itemvector* items = NULL;
+	
+	if (root->count > LJ_ITEMVECTOR_THRESHOLD)
+		items = root->v.c.index.items = lj_itemvector_new(&(document->arena), NULL, root->count);
+	
+	for (json_value_ref child = root->v.c.child; child; child = child->next) {
+#ifdef LJ_VALUE_PARENT
+		child->parent = root;
+#endif
 		
-			if (current == '"') {
-				// string, probably
-				
-				char* strV = NULL;
-				json_index_t strVLength = lj_substring_until(input + index, '"', '\0', &strV, false);
-				
-				index += strVLength + 1;
-				
-				// make an empty string if it is one
-				if (!strV)
-					strV = ljmalloc(sizeof(char));
-					
-				ljprintf("found a string, strV = \"%s\" (length = %u)", strV, strVLength);
-				
-				LJ_INIT_EMPTY_OBJ(newObj)
-			
-				newObj->type = JSON_TYPE_STRING;
-				newObj->strV = strV;
-				newObj->numV = ljatof(strV);
-			
-				// adapt parent attributes correctly
-				LJ_ADAPT_OBJ_PARENT(newObj)
-				value = newObj;
-			} else {
-				// need to read till the end first
-				
-				char* token = NULL;
-				json_index_t tokenLength = lj_substring_until(input + index, LJ_STRINGOPS_JSONTOK, '\0', &token, true);
-				
-				index += tokenLength + 1;
-				
-				ljprintf("found a (yet) undefined token = \"%s\", length = %u", token, tokenLength);
-				
-				LJ_INIT_EMPTY_OBJ(newObj)
-				
-				if (strcmp(token, "null") == 0) {
-					// a null value, add a placeholder string value and
-					// move on
-					newObj->strV = ljmalloc(sizeof(char));
-					free(token);
-				} else if (ljisdigit_str(token)) {
-					// a numeric value
-					newObj->type = JSON_TYPE_NUMBER;
-					newObj->strV = token;
-					newObj->numV = ljatof(token);
-				} else if (strcmp(token, "true") == 0 || 
-						   strcmp(token, "false") == 0) {
-					// a boolean value
-					newObj->type = JSON_TYPE_BOOLEAN;
-					newObj->strV = token;
-					newObj->numV = (strcmp(token, "true") == 0);
-				} else {
-					free(token); // quick clean up
-				
-					json_value_release(newObj);
-					LJ_ERROR("Expected a valid JSON value, got '%c' token", current);
-				} 
-				
-				// adapt parent attributes correctly
-				LJ_ADAPT_OBJ_PARENT(newObj)
-				value = newObj;
-				continue;
+		if (items)
+			items->items[items->count++] = child;
+	}
+	
+	document->root = root;
+	return document;
+}
+
+//
+// parallel parsing - public
+//
+
+json_document_ref json_document_parse_parallel(const char* input, const size_t length,
+											   const json_index_t threads,
+											   json_error* errorP) {
+	json_document_ref result = NULL;
+	
+	if (input && (result = lj_document_parse_parallel(input, length, true, threads))) {
+		LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, NULL))
+		return result;
+	}
+	
+	// small, malformed or not an array - no point in doing it in parallel
+	return json_document_parse(input, length, errorP);
+}
+
+json_document_ref json_document_parse_batch_parallel(const char* input,
+													 const size_t length,
+													 const json_index_t threads,
+													 json_error* errorP) {
+	json_document_ref result = NULL;
+	
+	if (input && (result = lj_document_parse_parallel(input, length, false, threads))) {
+		LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, NULL))
+		return result;
+	}
+	
+	return json_document_parse_batch(input, length, errorP);
+}
+
+//
+// json_stream - public
+//
+
+struct json_stream_s {
+	// parsing state kept between the chunks
+	lj_parser parser;
+	
+	const json_handler* handler;
+	void* context;
+	
+	// json_stream_new_tree streams only
+	lj_builder builder;
+	
+	// incomplete token carried over to the next chunk
+	char* pending;
+	size_t pendingLength;
+	size_t pendingSize;
+	// the pending token is a string ending with an unfinished escape sequence
+	bool pendingEscaped;
+	
+	// a chunk failed to parse, so will all the next ones
+	bool failed;
+	// json_stream_finish was called
+	bool finished;
+	// the built tree was handed out by json_stream_get_root
+	bool rootTaken;
+};
+
+/// appends length bytes of data to the pending token
+void lj_stream_stash(json_stream_ref stream, const char* data, const size_t length) {
+	if ((stream->pendingLength + length) > stream->pendingSize) {
+		stream->pendingSize = stream->pendingSize ? stream->pendingSize : LJ_STRINGOPS_BUFBASE;
+		
+		while ((stream->pendingLength + length) > stream->pendingSize)
+			stream->pendingSize *= 2;
+		
+		stream->pending = realloc(stream->pending, stream->pendingSize);
+	}
+	
+	// data might already be a part of the pending buffer
+	memmove(stream->pending + stream->pendingLength, data, length);
+	stream->pendingLength += length;
+}
+
+///
+/// finds the amount of chunk bytes that complete the pending token (including
+/// the delimiter after scalars), returns false if the whole chunk belongs to it
+///
+bool lj_stream_token_end(json_stream_ref stream, const char* chunk,
+						 const size_t length, size_t* endP) {
+	if (stream->pending[0] != '"') {
+		for (size_t i = 0; i < length; i++) {
+			if (LJ_IS_JSONTOK(chunk[i])) {
+				(*endP) = i + 1;
+				return true;
 			}
 		}
 		
-		if (state == JSON_STATE_KEY) {
-			ljprintf("handled: object state -> key");
+		return false;
+	}
+	
+	bool escaped = stream->pendingEscaped;
+	
+	for (size_t i = 0; i < length; i++) {
+		if (escaped)
+			escaped = false;
+		else if (chunk[i] == '\\')
+			escaped = true;
+		else if (chunk[i] == '"') {
+			(*endP) = i + 1;
+			return true;
+		}
+	}
+	
+	stream->pendingEscaped = escaped;
+	return false;
+}
+
+///
+/// parses the next piece of input, stashing the incomplete token at its end
+/// (if there is one) into the pending buffer
+///
+bool lj_stream_run(json_stream_ref stream, const char* input, const size_t length,
+				   json_error* errorP) {
+	lj_parser* p = &(stream->parser);
+	lj_parser_reset_input(p, input, length);
+	
+	size_t consumed = 0;
+	
+	if (!lj_parser_run(p, stream->handler, stream->context, &consumed, errorP)) {
+		stream->failed = true;
+		lj_builder_discard(&(stream->builder));
 		
-			// we are inside {} (object) - looking for keys
-			if (current == '"') {
-				ljprintf("key found at %u", index);
-			
-				char* key = NULL;
-				json_index_t keyLength = lj_substring_until(input + index, '"', '\0', &key, false);
-				
-				index += keyLength + 1;
-				futureKey = key;
-				
-				ljprintf("futureKey = \"%s\", length = %u", futureKey, keyLength);
-				continue;
-			} else if (current == ':') {
-				ljprintf("key delimiter found at %u", index);
-				
-				// need the key to be found first
-				if (!futureKey)
-					LJ_ERROR("Expected key, got '%c' instead", current)
-					
-				ljprintf("state change -> value");
-				state = JSON_STATE_VALUE;
-			} else if (current == ',') {
-				ljprintf("comma jump");
-				continue;
-			} else if (current == '}') {
-				// the end of this object
-				ljprintf("reached } at %u", current);
-				
-				// if we are a child item, we need to first reach out parent
-				// container to close it
-				LJ_JUMP_TO_CHILDS_PARENT_MULTI(value, JSON_TYPE_OBJECT)
-				
-				if (!value)
-					LJ_ERROR("Stray object end token")
-				
-				LJ_CLOSE_AND_JUMP_TO_PARENT(value)
-					
-				ljprintf("state change -> %u", state);
-			} else
-				LJ_ERROR("Expected key, got '%c' instead", current);
-		} else if (state == JSON_STATE_VALUE || state == JSON_STATE_ARRAY) {
-			// found value, need to get its raw string and then recursively parse
-			// it
-			ljprintf("handled: object state -> value");
-					 
-			const char ending = (state == JSON_STATE_ARRAY) ? ']' : '}';
-			ljprintf("recognized ending - '%c'", ending);
-			
-			// handle array ending correctly
-			if (state == JSON_STATE_ARRAY) {
-				if (current == ',') {
-					// array comma jump
-					ljprintf("array comma jump");
-					continue;
-				} else if (current == ']') {
-					ljprintf("reached the closing bracket ] at %u", index);
-					
-					LJ_JUMP_TO_CHILDS_PARENT_MULTI(value, JSON_TYPE_ARRAY)
-				
-					if (!value)
-						LJ_ERROR("Stray array end token")
-				
-					LJ_CLOSE_AND_JUMP_TO_PARENT(value)
-					
-					ljprintf("state change -> %u", state);
-					continue;
-				}
-			}
-			
-			char* valueRaw = NULL;
-			json_index_t valueRawLength = lj_substring_until(input + index, ',', ending, &valueRaw, false);
-			
-			if (!valueRaw)
-				LJ_ERROR("Expected value, got nothing")
-			
-			ljprintf("found valueRaw = \"%s\" (%u) at %u", valueRaw, valueRawLength, index);
-			index += valueRawLength - 1;
-			
-			ljprintf("index updated to %u -> '%c'", index, input[index]);
-			
-			// strip spaces from the ending
-			lj_substring_strip_right(valueRaw);
-			
-			// time of recursive parsing
-			json_error adaptedError;
-			json_value_ref newObj = json_parse(valueRaw, &adaptedError);
-			
-			// avoid memory leaks and clean up a bit
-			free(valueRaw);
-			
-			if (adaptedError.fail) {
-				// first adapt error report values to proper ones
-				adaptedError.line += lineC - 1;
-				adaptedError.character += charC;
-				
-				// now we have to fail the parent too
-				json_value_release_tree(value);
-				LJ_IF_NOT_NULL(errorP, adaptedError)
-				return NULL;
-			}
-			
-			// otherwise, we got ourselves a new object
-			ljprintf("new object <%p>, key = \"%s\", type = %u", newObj, futureKey, newObj->type);
-			
-			if (futureKey) {
-				// set the object's label appropriately
-				newObj->key = futureKey;
-				futureKey = NULL;
-			}
-			
-			// adapt object parent
-			LJ_ADAPT_OBJ_PARENT(newObj)
-			value = newObj;
-			
-			if (value->parent && value->parent->type == JSON_TYPE_OBJECT) {
-				ljprintf("state changed -> key");
-				state = JSON_STATE_KEY;
-			}
+		return false;
+	}
+	
+	lj_parser_skip_location(p, consumed);
+	
+	// input might be the pending buffer itself
+	const size_t tailLength = length - consumed;
+	
+	stream->pendingLength = 0;
+	stream->pendingEscaped = false;
+	
+	if (tailLength > 0) {
+		lj_stream_stash(stream, input + consumed, tailLength);
+		
+		// an unfinished escape sequence at the end of a string
+		for (size_t i = 1; i < tailLength && stream->pending[0] == '"'; i++)
+			stream->pendingEscaped = stream->pending[i] == '\\' && !stream->pendingEscaped;
+	}
+	
+	return true;
+}
+
+json_stream_ref json_stream_new(const json_handler* handler, void* context) {
+	if (!handler) {
+		ljprintf("NULL handler provided");
+		return NULL;
+	}
+	
+	json_stream_ref result = ljmalloc_s(json_stream_s);
+	result->parser.partial = true;
+	result->handler = handler;
+	result->context = context;
+	
+	return result;
+}
+
+json_stream_ref json_stream_new_tree(void) {
+	json_stream_ref result = json_stream_new(&lj_builder_handler, NULL);
+	result->context = &(result->builder);
+	
+	return result;
+}
+
+bool json_stream_feed(json_stream_ref stream, const char* chunk,
+					  const size_t length, json_error* errorP) {
+	if (!stream || stream->failed || stream->finished) {
+		LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, "The stream has already failed or finished"));
+		return false;
+	} else if (!chunk && length > 0) {
+		LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, "NULL chunk provided as input"));
+		return false;
+	}
+	
+	// success boilerplate saved for the future
+	LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, NULL))
+	
+	size_t used = 0;
+	
+	if (stream->pendingLength > 0) {
+		// complete the pending token with as few bytes of the chunk as
+		// possible, the rest is parsed right from the caller's memory
+		if (!lj_stream_token_end(stream, chunk, length, &used)) {
+			lj_stream_stash(stream, chunk, length);
+			return true;
+		}
+		
+		lj_stream_stash(stream, chunk, used);
+		
+		if (!lj_stream_run(stream, stream->pending, stream->pendingLength, errorP))
+			return false;
+		else if (stream->pendingLength > 0) {
+			// keep the order of the input intact
+			lj_stream_stash(stream, chunk + used, length - used);
+			return true;
 		}
 	}
 	
-	return root;
+	return lj_stream_run(stream, chunk + used, length - used, errorP);
+}
+
+bool json_stream_finish(json_stream_ref stream, json_error* errorP) {
+	if (!stream || stream->failed || stream->finished) {
+		LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, "The stream has already failed or finished"));
+		return false;
+	}
+	
+	LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, NULL))
+	
+	// whatever is pending now has to be complete
+	stream->parser.partial = false;
+	stream->finished = true;
+	
+	return lj_stream_run(stream, stream->pending, stream->pendingLength, errorP);
+}
+
+json_value_ref json_stream_get_root(const json_stream_ref stream) {
+	if (!stream || !stream->finished || stream->failed)
+		return NULL;
+	
+	stream->rootTaken = true;
+	return stream->builder.root;
+}
+
+void json_stream_release(json_stream_ref stream) {
+	if (!stream)
+		return;
+	
+	// a successfully parsed tree belongs to the caller once it was retreived
+	if (!stream->finished || stream->failed || !stream->rootTaken)
+		lj_builder_discard(&(stream->builder));
+	else
+		lj_builder_cleanup(&(stream->builder));
+	
+	lj_parser_cleanup(&(stream->parser));
+	free(stream->pending);
+	free(stream);
+}
+
+//
+// json_reader - public
+//
+
+struct json_reader_s {
+	lj_parser parser;
+	
+	// a parsing error occured, so will all the next reads
+	bool failed;
+};
+
+json_reader_ref json_reader_new(const char* input, const size_t length) {
+	if (!input || length < 1) {
+		ljprintf("NULL or empty string provided as input");
+		return NULL;
+	}
+	
+	json_reader_ref result = ljmalloc_s(json_reader_s);
+	lj_parser_reset_input(&(result->parser), input, length);
+	
+	return result;
+}
+
+json_token_t json_reader_next(json_reader_ref reader, json_token* tokenP,
+							  json_error* errorP) {
+	json_token token = { 0 };
+	
+	if (!reader || reader->failed) {
+		LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, "The reader has already failed"));
+		return JSON_TOKEN_ERROR;
+	}
+	
+	LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, NULL))
+	
+	if (!lj_parser_next(&(reader->parser), &token, errorP)) {
+		reader->failed = true;
+		token.type = JSON_TOKEN_ERROR;
+	}
+	
+	LJ_IF_NOT_NULL(tokenP, token)
+	return token.type;
 }
 
-// undef all json_parse-related macros so that they won't be used in
-// other methods by accident
-#undef LJ_CLOSE_AND_JUMP_TO_PARENT
-#undef LJ_JUMP_TO_CHILDS_PARENT_MULTI
-#undef LJ_ADAPT_OBJ_PARENT
-#undef LJ_INIT_EMPTY_OBJ
-#undef LJ_ERROR
+json_token_t json_reader_skip(json_reader_ref reader, json_error* errorP) {
+	json_token token = { 0 };
+	
+	if (!reader || reader->failed) {
+		LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, "The reader has already failed"));
+		return JSON_TOKEN_ERROR;
+	}
+	
+	LJ_IF_NOT_NULL(errorP, json_error_make(0, 0, NULL))
+	
+	if (!lj_parser_skip(&(reader->parser), &token, errorP)) {
+		reader->failed = true;
+		return JSON_TOKEN_ERROR;
+	}
+	
+	return token.type;
+}
+
+json_index_t json_reader_get_depth(const json_reader_ref reader) {
+	return (reader ? reader->parser.depth : 0);
+}
+
+void json_reader_release(json_reader_ref reader) {
+	if (!reader)
+		return;
+	
+	lj_parser_cleanup(&(reader->parser));
+	free(reader);
+}
 
 //
 // json_value_ref API - private
@@ -696,29 +3480,403 @@ json_value_ref json_value_init(const json_type_t type) {
 
 #define LJ_CLEAN_PREVIOUS_VALUE(value) \
 { \
-	free(value->strV); \
-	value->strV = NULL; \
+	if (value->type == JSON_TYPE_STRING && \
+		!(value->flags & (LJ_VALUE_BORROWED_STR | LJ_VALUE_INLINE_STR))) \
+		free(value->v.strV); \
 	\
 	if (LJ_IS_CONTAINER(value)) { \
-		json_value_release_tree(value->child); \
-		value->child = NULL; \
+		json_value_release_tree(value->v.c.child); \
+		\
+		if (value->type == JSON_TYPE_OBJECT) \
+			lj_keyindex_release(value->v.c.index.keys, NULL, NULL); \
+		else \
+			lj_itemvector_release(value->v.c.index.items, NULL, NULL); \
+		\
+		value->count = 0; \
 	} \
+	\
+	memset(&(value->v), 0, sizeof(value->v)); \
+	value->flags &= ~(LJ_VALUE_BORROWED_STR | LJ_VALUE_INLINE_STR | \
+					  LJ_VALUE_INT64 | LJ_VALUE_UINT64); \
+}
+
+/// [lj_format_number] double-precision float as an unpacked f * 2^e pair
+typedef struct {
+	uint64_t f;
+	int e;
+} lj_diyfp;
+
+/// [lj_format_number] normalized 10^k for k = -348, -340, ..., 340
+static const lj_diyfp lj_cached_pow10[] = {
+	{ UINT64_C(0xfa8fd5a0081c0288), -1220 }, { UINT64_C(0xbaaee17fa23ebf76), -1193 },
+	{ UINT64_C(0x8b16fb203055ac76), -1166 }, { UINT64_C(0xcf42894a5dce35ea), -1140 },
+	{ UINT64_C(0x9a6bb0aa55653b2d), -1113 }, { UINT64_C(0xe61acf033d1a45df), -1087 },
+	{ UINT64_C(0xab70fe17c79ac6ca), -1060 }, { UINT64_C(0xff77b1fcbebcdc4f), -1034 },
+	{ UINT64_C(0xbe5691ef416bd60c), -1007 }, { UINT64_C(0x8dd01fad907ffc3c), -980 },
+	{ UINT64_C(0xd3515c2831559a83), -954 }, { UINT64_C(0x9d71ac8fada6c9b5), -927 },
+	{ UINT64_C(0xea9c227723ee8bcb), -901 }, { UINT64_C(0xaecc49914078536d), -874 },
+	{ UINT64_C(0x823c12795db6ce57), -847 }, { UINT64_C(0xc21094364dfb5637), -821 },
+	{ UINT64_C(0x9096ea6f3848984f), -794 }, { UINT64_C(0xd77485cb25823ac7), -768 },
+	{ UINT64_C(0xa086cfcd97bf97f4), -741 }, { UINT64_C(0xef340a98172aace5), -715 },
+	{ UINT64_C(0xb23867fb2a35b28e), -688 }, { UINT64_C(0x84c8d4dfd2c63f3b), -661 },
+	{ UINT64_C(0xc5dd44271ad3cdba), -635 }, { UINT64_C(0x936b9fcebb25c996), -608 },
+	{ UINT64_C(0xdbac6c247d62a584), -582 }, { UINT64_C(0xa3ab66580d5fdaf6), -555 },
+	{ UINT64_C(0xf3e2f893dec3f126), -529 }, { UINT64_C(0xb5b5ada8aaff80b8), -502 },
+	{ UINT64_C(0x87625f056c7c4a8b), -475 }, { UINT64_C(0xc9bcff6034c13053), -449 },
+	{ UINT64_C(0x964e858c91ba2655), -422 }, { UINT64_C(0xdff9772470297ebd), -396 },
+	{ UINT64_C(0xa6dfbd9fb8e5b88f), -369 }, { UINT64_C(0xf8a95fcf88747d94), -343 },
+	{ UINT64_C(0xb94470938fa89bcf), -316 }, { UINT64_C(0x8a08f0f8bf0f156b), -289 },
+	{ UINT64_C(0xcdb02555653131b6), -263 }, { UINT64_C(0x993fe2c6d07b7fac), -236 },
+	{ UINT64_C(0xe45c10c42a2b3b06), -210 }, { UINT64_C(0xaa242499697392d3), -183 },
+	{ UINT64_C(0xfd87b5f28300ca0e), -157 }, { UINT64_C(0xbce5086492111aeb), -130 },
+	{ UINT64_C(0x8cbccc096f5088cc), -103 }, { UINT64_C(0xd1b71758e219652c), -77 },
+	{ UINT64_C(0x9c40000000000000), -50 }, { UINT64_C(0xe8d4a51000000000), -24 },
+	{ UINT64_C(0xad78ebc5ac620000), 3 }, { UINT64_C(0x813f3978f8940984), 30 },
+	{ UINT64_C(0xc097ce7bc90715b3), 56 }, { UINT64_C(0x8f7e32ce7bea5c70), 83 },
+	{ UINT64_C(0xd5d238a4abe98068), 109 }, { UINT64_C(0x9f4f2726179a2245), 136 },
+	{ UINT64_C(0xed63a231d4c4fb27), 162 }, { UINT64_C(0xb0de65388cc8ada8), 189 },
+	{ UINT64_C(0x83c7088e1aab65db), 216 }, { UINT64_C(0xc45d1df942711d9a), 242 },
+	{ UINT64_C(0x924d692ca61be758), 269 }, { UINT64_C(0xda01ee641a708dea), 295 },
+	{ UINT64_C(0xa26da3999aef774a), 322 }, { UINT64_C(0xf209787bb47d6b85), 348 },
+	{ UINT64_C(0xb454e4a179dd1877), 375 }, { UINT64_C(0x865b86925b9bc5c2), 402 },
+	{ UINT64_C(0xc83553c5c8965d3d), 428 }, { UINT64_C(0x952ab45cfa97a0b3), 455 },
+	{ UINT64_C(0xde469fbd99a05fe3), 481 }, { UINT64_C(0xa59bc234db398c25), 508 },
+	{ UINT64_C(0xf6c69a72a3989f5c), 534 }, { UINT64_C(0xb7dcbf5354e9bece), 561 },
+	{ UINT64_C(0x88fcf317f22241e2), 588 }, { UINT64_C(0xcc20ce9bd35c78a5), 614 },
+	{ UINT64_C(0x98165af37b2153df), 641 }, { UINT64_C(0xe2a0b5dc971f303a), 667 },
+	{ UINT64_C(0xa8d9d1535ce3b396), 694 }, { UINT64_C(0xfb9b7cd9a4a7443c), 720 },
+	{ UINT64_C(0xbb764c4ca7a44410), 747 }, { UINT64_C(0x8bab8eefb6409c1a), 774 },
+	{ UINT64_C(0xd01fef10a657842c), 800 }, { UINT64_C(0x9b10a4e5e9913129), 827 },
+	{ UINT64_C(0xe7109bfba19c0c9d), 853 }, { UINT64_C(0xac2820d9623bf429), 880 },
+	{ UINT64_C(0x80444b5e7aa7cf85), 907 }, { UINT64_C(0xbf21e44003acdd2d), 933 },
+	{ UINT64_C(0x8e679c2f5e44ff8f), 960 }, { UINT64_C(0xd433179d9c8cb841), 986 },
+	{ UINT64_C(0x9e19db92b4e31ba9), 1013 }, { UINT64_C(0xeb96bf6ebadf77d9), 1039 },
+	{ UINT64_C(0xaf87023b9bf0ee6b), 1066 }
+};
+
+/// [lj_format_number] powers of ten that fit into uint64_t
+static const uint64_t lj_pow10_u64[] = {
+	UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000), UINT64_C(10000),
+	UINT64_C(100000), UINT64_C(1000000), UINT64_C(10000000), UINT64_C(100000000),
+	UINT64_C(1000000000), UINT64_C(10000000000), UINT64_C(100000000000),
+	UINT64_C(1000000000000), UINT64_C(10000000000000), UINT64_C(100000000000000),
+	UINT64_C(1000000000000000), UINT64_C(10000000000000000),
+	UINT64_C(100000000000000000), UINT64_C(1000000000000000000),
+	UINT64_C(10000000000000000000)
+};
+
+/// 52 explicitly stored bits of the significand and the implicit one
+#define LJ_DOUBLE_SIGNIFICAND UINT64_C(0x000FFFFFFFFFFFFF)
+#define LJ_DOUBLE_HIDDEN UINT64_C(0x0010000000000000)
+
+/// upper 64 bits of the 128-bit product, rounded
+static inline lj_diyfp lj_diyfp_multiply(const lj_diyfp a, const lj_diyfp b) {
+	const uint64_t mask = UINT64_C(0xFFFFFFFF);
+	const uint64_t aHigh = a.f >> 32, aLow = a.f & mask;
+	const uint64_t bHigh = b.f >> 32, bLow = b.f & mask;
+
+	const uint64_t hh = aHigh * bHigh;
+	const uint64_t lh = aLow * bHigh;
+	const uint64_t hl = aHigh * bLow;
+	const uint64_t ll = aLow * bLow;
+
+	const uint64_t middle = (ll >> 32) + (hl & mask) + (lh & mask) + (UINT64_C(1) << 31);
+	const lj_diyfp result = { hh + (hl >> 32) + (lh >> 32) + (middle >> 32), a.e + b.e + 64 };
+
+	return result;
+}
+
+/// shifts f left until its topmost bit is set
+static inline lj_diyfp lj_diyfp_normalize(lj_diyfp input) {
+	const json_index_t shift = lj_clz64(input.f);
+
+	input.f <<= shift;
+	input.e -= (int)shift;
+
+	return input;
+}
+
+///
+/// [lj_format_number] Grisu2 - writes the shortest (in all but a few rare
+/// cases) digits that read back as the specified positive finite number.
+/// The number is then digits * 10^(*exponentP)
+///
+json_index_t lj_grisu2(const json_number_t input, char* digits, int* exponentP) {
+	uint64_t bits = 0;
+	memcpy(&bits, &input, sizeof(bits));
+
+	const int biased = (int)((bits >> 52) & 0x7FF);
+	lj_diyfp v = { bits & LJ_DOUBLE_SIGNIFICAND, -1074 };
+
+	if (biased != 0) {
+		v.f += LJ_DOUBLE_HIDDEN;
+		v.e = biased - 1075;
+	}
+
+	// boundaries between this number and its neighbours, the lower one is
+	// closer if this is the smallest significand of its exponent
+	lj_diyfp upper = { (v.f << 1) + 1, v.e - 1 };
+	upper = lj_diyfp_normalize(upper);
+
+	lj_diyfp lower = (v.f == LJ_DOUBLE_HIDDEN) ?
+					 (lj_diyfp){ (v.f << 2) - 1, v.e - 2 } :
+					 (lj_diyfp){ (v.f << 1) - 1, v.e - 1 };
+	lower.f <<= (lower.e - upper.e);
+	lower.e = upper.e;
+
+	// pick a cached power of ten that brings the exponent into [-60, -32]
+	const double dk = (-61 - upper.e) * 0.30102999566398114 + 347;
+	int k = (int)dk;
+
+	if (dk - k > 0.0)
+		k++;
+
+	const json_index_t cachedIndex = (json_index_t)((k >> 3) + 1);
+	const lj_diyfp cached = lj_cached_pow10[cachedIndex];
+	int exponent = -(-348 + (int)cachedIndex * 8);
+
+	const lj_diyfp w = lj_diyfp_multiply(lj_diyfp_normalize(v), cached);
+	lj_diyfp high = lj_diyfp_multiply(upper, cached);
+	lj_diyfp low = lj_diyfp_multiply(lower, cached);
+
+	// stay on the safe side of the imprecise boundaries
+	low.f++;
+	high.f--;
+
+	// digit generation - integral part first, then the fraction
+	const json_index_t shift = (json_index_t)(-high.e);
+	const uint64_t one = UINT64_C(1) << shift;
+	const uint64_t distance = high.f - w.f;
+	uint64_t delta = high.f - low.f;
+
+	uint32_t integral = (uint32_t)(high.f >> shift);
+	uint64_t fraction = high.f & (one - 1);
+
+	json_index_t kappa = 1;
+	json_index_t length = 0;
+
+	while (kappa < 10 && integral >= lj_pow10_u64[kappa])
+		kappa++;
+
+	uint64_t rest = 0;
+	uint64_t unit = 0;
+	uint64_t scaledDistance = distance;
+	bool done = false;
+
+	while (kappa > 0 && !done) {
+		const uint32_t divisor = (uint32_t)lj_pow10_u64[kappa - 1];
+		const uint32_t digit = integral / divisor;
+		integral %= divisor;
+
+		if (digit || length)
+			digits[length++] = (char)('0' + digit);
+
+		kappa--;
+		rest = ((uint64_t)integral << shift) + fraction;
+
+		if (rest <= delta) {
+			exponent += (int)kappa;
+			unit = lj_pow10_u64[kappa] << shift;
+			done = true;
+		}
+	}
+
+	// amount of fractional digits generated so far
+	json_index_t fractional = 0;
+
+	while (!done) {
+		fraction *= 10;
+		delta *= 10;
+
+		const char digit = (char)(fraction >> shift);
+
+		if (digit || length)
+			digits[length++] = (char)('0' + digit);
+
+		fraction &= one - 1;
+		fractional++;
+
+		if (fraction < delta) {
+			exponent -= (int)fractional;
+			rest = fraction;
+			unit = one;
+			scaledDistance = (fractional < 20) ? distance * lj_pow10_u64[fractional] : 0;
+			done = true;
+		}
+	}
+
+	// walk the last digit towards the exact value while staying in range
+	while (rest < scaledDistance && delta - rest >= unit &&
+		   (rest + unit < scaledDistance || scaledDistance - rest > rest + unit - scaledDistance)) {
+		digits[length - 1]--;
+		rest += unit;
+	}
+
+	(*exponentP) = exponent;
+	return length;
+}
+
+/// writes the decimal exponent of lj_format_number output
+static inline json_index_t lj_format_exponent(int exponent, char* output) {
+	json_index_t length = 0;
+	output[length++] = 'e';
+	output[length++] = (exponent < 0) ? '-' : '+';
+
+	if (exponent < 0)
+		exponent = -exponent;
+
+	if (exponent >= 100)
+		output[length++] = (char)('0' + exponent / 100);
+	if (exponent >= 10)
+		output[length++] = (char)('0' + (exponent / 10) % 10);
+
+	output[length++] = (char)('0' + exponent % 10);
+	return length;
 }
 
-/// double -> C string
-char* ljftoa(const json_number_t input) {
-	char* result = calloc(LJ_STRINGOPS_NUMMAX, sizeof(char));
+///
+/// formats the specified number into output (at least LJ_STRINGOPS_NUMMAX
+/// bytes long) as the shortest text that reads back as the same number and
+/// returns its length
+///
+json_index_t lj_format_number(json_number_t input, char* output) {
+	if (!isfinite(input)) {
+		// JSON has no way to represent these
+		memcpy(output, "null", 5);
+		return 4;
+	}
 	
-	// TODO: optimize
-	int32_t forceRound = (int32_t)input;
+	json_index_t length = 0;
 	
-	// if there are no numbers after the comma, read it as int32_t
-	if ((json_number_t)(forceRound) == input)
-		sprintf(result, "%d", forceRound);
-	else
-		sprintf(result, "%lf", input);
+	if (signbit(input)) {
+		output[length++] = '-';
+		input = -input;
+	}
+	
+	if (input == 0.0) {
+		output[length++] = '0';
+		output[length] = '\0';
+		return length;
+	}
+	
+	char* digits = output + length;
+	int exponent = 0;
+	const json_index_t count = lj_grisu2(input, digits, &exponent);
+	
+	// position of the decimal point relative to the first digit
+	const int point = (int)count + exponent;
+	
+	if (exponent >= 0 && point <= 21) {
+		// integer - 1234500
+		memset(digits + count, '0', (size_t)exponent);
+		length += (json_index_t)point;
+	} else if (point > 0 && point <= 21) {
+		// 123.45
+		memmove(digits + point + 1, digits + point, count - (json_index_t)point);
+		digits[point] = '.';
+		length += count + 1;
+	} else if (point > -6 && point <= 0) {
+		// 0.0012345
+		const json_index_t zeroes = (json_index_t)(2 - point);
 		
-	return result;
+		memmove(digits + zeroes, digits, count);
+		memcpy(digits, "0.", 2);
+		memset(digits + 2, '0', zeroes - 2);
+		length += zeroes + count;
+	} else {
+		// 1.2345e+67
+		if (count > 1) {
+			memmove(digits + 2, digits + 1, count - 1);
+			digits[1] = '.';
+		}
+		
+		const json_index_t mantissa = (count > 1) ? count + 1 : 1;
+		length += mantissa + lj_format_exponent(point - 1, digits + mantissa);
+	}
+	
+	output[length] = '\0';
+	return length;
+}
+
+///
+/// formats the specified integer (or its negation if negative is set) into
+/// output (at least LJ_STRINGOPS_NUMMAX bytes long) and returns its length
+///
+json_index_t lj_format_integer(uint64_t magnitude, const bool negative, char* output) {
+	static const char pairs[] =
+		"00010203040506070809101112131415161718192021222324"
+		"25262728293031323334353637383940414243444546474849"
+		"50515253545556575859606162636465666768697071727374"
+		"75767778798081828384858687888990919293949596979899";
+	
+	// digits are produced from the end, two at a time
+	char reversed[LJ_STRINGOPS_NUMMAX];
+	json_index_t end = LJ_STRINGOPS_NUMMAX;
+	
+	while (magnitude >= 100) {
+		const json_index_t pair = (json_index_t)(magnitude % 100) * 2;
+		magnitude /= 100;
+		
+		reversed[--end] = pairs[pair + 1];
+		reversed[--end] = pairs[pair];
+	}
+	
+	if (magnitude >= 10) {
+		reversed[--end] = pairs[magnitude * 2 + 1];
+		reversed[--end] = pairs[magnitude * 2];
+	} else
+		reversed[--end] = (char)('0' + magnitude);
+	
+	json_index_t length = 0;
+	
+	if (negative)
+		output[length++] = '-';
+	
+	memcpy(output + length, reversed + end, LJ_STRINGOPS_NUMMAX - end);
+	length += LJ_STRINGOPS_NUMMAX - end;
+	
+	output[length] = '\0';
+	return length;
+}
+
+///
+/// [json_value_get_*] retreives both the numeric and the exact integral value
+/// of the specified value (converting strings on the way) and returns the
+/// kind of the latter
+///
+json_integer_t lj_value_number(const json_value_ref value, json_number_t* numberP,
+							   uint64_t* integerP) {
+	if (!value)
+		return JSON_INTEGER_NONE;
+	else if (value->type == JSON_TYPE_STRING) {
+		json_integer_t integral = JSON_INTEGER_NONE;
+		
+		if (!lj_parse_number(LJ_VALUE_STR(value), value->count, numberP, &integral, integerP))
+			return JSON_INTEGER_NONE;
+		
+		return integral;
+	}
+	
+	else if (value->type == JSON_TYPE_BOOLEAN) {
+		(*numberP) = value->v.boolV;
+		(*integerP) = value->v.boolV;
+		
+		return JSON_INTEGER_SIGNED;
+	} else if (value->type != JSON_TYPE_NUMBER)
+		return JSON_INTEGER_NONE;
+	
+	(*integerP) = value->v.uintV;
+	
+	if (value->flags & LJ_VALUE_INT64) {
+		(*numberP) = (json_number_t)(value->v.intV);
+		return JSON_INTEGER_SIGNED;
+	} else if (value->flags & LJ_VALUE_UINT64) {
+		(*numberP) = (json_number_t)(value->v.uintV);
+		return JSON_INTEGER_UNSIGNED;
+	}
+	
+	(*numberP) = value->v.numV;
+	return JSON_INTEGER_NONE;
 }
 
 json_value_ref json_value_get_neighbor(json_value_ref base,
@@ -747,6 +3905,7 @@ json_value_ref json_value_get_neighbor(json_value_ref base,
 
 json_value_ref json_value_find_by_key(json_value_ref base,
 									  const char* key,
+									  const size_t keyLength,
 									  json_value_ref* previousP) {
 	if (!base || !key)
 		return NULL; // cannot start with NULL
@@ -755,7 +3914,7 @@ json_value_ref json_value_find_by_key(json_value_ref base,
 	json_value_ref previous = NULL;
 	
 	while (current) {
-		if (current->key && strcmp(current->key, key) == 0) {
+		if (lj_value_key_equals(current, key, keyLength)) {
 			// found the one
 			LJ_IF_NOT_NULL(previousP, previous)
 			return current;
@@ -769,189 +3928,440 @@ json_value_ref json_value_find_by_key(json_value_ref base,
 	return NULL;
 }
 
-char* lj_unescape_str(const char* input) {
-	if (!input)
-		return NULL;
+///
+/// unlinks the child item at the specified position from the container,
+/// keeping all of its caches up to date, and releases it
+///
+bool lj_container_remove_at(json_value_ref container, const json_index_t where) {
+	if (!container || !LJ_IS_CONTAINER(container) || where >= container->count)
+		return false;
+	else if (LJ_IS_READONLY(container)) {
+		ljprintf("document-owned values are read-only");
+		return false;
+	}
+	
+	// find the item before the removed one
+	json_value_ref previous = NULL;
+	
+	if (where > 0) {
+		if (container->type == JSON_TYPE_ARRAY && container->v.c.index.items)
+			previous = container->v.c.index.items->items[where - 1];
+		else
+			previous = json_value_get_neighbor(container->v.c.child, where - 1, false, NULL);
+	}
+	
+	json_value_ref removed = previous ? previous->next : container->v.c.child;
+	
+	if (container->type == JSON_TYPE_OBJECT && container->v.c.index.keys)
+		lj_keyindex_remove(container->v.c.index.keys, removed, previous);
+	else if (container->type == JSON_TYPE_ARRAY && container->v.c.index.items)
+		lj_itemvector_remove(container->v.c.index.items, where);
+	
+	// unlink it
+	if (previous)
+		previous->next = removed->next;
+	else
+		container->v.c.child = removed->next;
+	
+	if (container->v.c.last == removed)
+		container->v.c.last = previous;
+	
+	container->count--;
+	
+	// and release it with all of its children
+	removed->next = NULL;
+	json_value_release_tree(removed);
+	
+	return true;
+}
+
+//
+// json_writer - private
+//
+
+/// growable output buffer of json_writer
+typedef struct {
+	char* data;
+	size_t length;
+	size_t size;
+} lj_buffer;
+
+/// makes sure that extra more bytes (plus a NUL) fit into the buffer
+static inline void lj_buffer_reserve(lj_buffer* buffer, const size_t extra) {
+	if ((buffer->length + extra) < buffer->size)
+		return;
+	
+	// grow geometrically, so that appending stays amortized O(1)
+	size_t size = buffer->size ? buffer->size : LJ_STRINGOPS_BUFBASE;
+	
+	while ((buffer->length + extra) >= size)
+		size *= 2;
+	
+	buffer->data = realloc(buffer->data, size);
+	buffer->size = size;
+}
+
+/// appends length bytes of the specified data to the buffer
+static inline void lj_buffer_append(lj_buffer* buffer, const char* data,
+									const size_t length) {
+	lj_buffer_reserve(buffer, length);
+	
+	memcpy(buffer->data + buffer->length, data, length);
+	buffer->length += length;
+}
+
+/// appends a single character to the buffer
+static inline void lj_buffer_putc(lj_buffer* buffer, const char current) {
+	lj_buffer_reserve(buffer, 1);
+	buffer->data[buffer->length++] = current;
+}
+
+/// appends the specified amount of spaces to the buffer
+static inline void lj_buffer_indent(lj_buffer* buffer, const json_index_t count) {
+	lj_buffer_reserve(buffer, count);
+	
+	memset(buffer->data + buffer->length, ' ', count);
+	buffer->length += count;
+}
+
+///
+/// finds the first character of [input, end) that can't appear in a JSON
+/// string as is - a doublequote, a backslash or a control character
+///
+static inline const char* lj_escape_find(const char* input, const char* end) {
+#ifdef LJ_HAVE_X86_SIMD
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i upperBits = _mm_set1_epi8((char)0xE0);
+	
+	while ((end - input) >= 16) {
+		const __m128i chunk = _mm_loadu_si128((const __m128i*)input);
+		
+		// control characters are the ones with none of the upper three bits set
+		__m128i found = _mm_cmpeq_epi8(_mm_and_si128(chunk, upperBits), _mm_setzero_si128());
+		found = _mm_or_si128(found, _mm_cmpeq_epi8(chunk, quote));
+		found = _mm_or_si128(found, _mm_cmpeq_epi8(chunk, backslash));
+		
+		const uint64_t mask = (uint16_t)_mm_movemask_epi8(found);
+		
+		if (mask)
+			return input + lj_ctz64(mask);
+		
+		input += 16;
+	}
+#else
+	const uint64_t ones = UINT64_C(0x0101010101010101);
+	const uint64_t highBits = ones * 0x80;
+	
+	while ((end - input) >= 8) {
+		uint64_t word;
+		memcpy(&word, input, sizeof(word));
+		
+		// the high bit of each byte is set if it is below 0x20 or equal to
+		// one of the two, never without a match anywhere in the word
+		const uint64_t found = ((word - ones * 0x20) |
+								((word ^ (ones * '"')) - ones) |
+								((word ^ (ones * '\\')) - ones)) & ~word & highBits;
+		
+		if (found)
+			break; // pinpointed by the loop below
+		
+		input += 8;
+	}
+#endif
+	
+	while (input < end) {
+		const uint8_t current = (uint8_t)(*input);
+		
+		if (current < 0x20 || current == '"' || current == '\\')
+			break;
+		
+		input++;
+	}
+	
+	return input;
+}
 
-	// TODO: optimize
-	json_index_t resultSize = strlen(input) * 2 + 2;
-	json_index_t resultLength = 1;
-	char* result = calloc(resultSize, sizeof(char));
+///
+/// appends length bytes of the input as a doublequoted string, escaping them
+/// on the way (including embedded NUL characters)
+///
+void lj_buffer_append_string(lj_buffer* buffer, const char* input,
+							 const size_t length) {
+	static const char hexDigits[] = "0123456789abcdef";
+	const char* end = input + length;
 	
-	// begin the resulting string with a double-quote
-	result[0] = '"';
+	lj_buffer_putc(buffer, '"');
 	
-	for (json_index_t i = 0; i < strlen(input); i++) {
-		char current = input[i];
-		bool doEscape = false;
+	while (input < end) {
+		// copy runs of characters that need no escaping in one go
+		const char* special = lj_escape_find(input, end);
+		lj_buffer_append(buffer, input, special - input);
+		
+		if (special >= end)
+			break;
+		
+		const uint8_t current = (uint8_t)(*special);
+		char escaped = '\0';
 		
 		switch (current) {
 			case '\\':
 			case '"': {
-				doEscape = true;
+				escaped = (char)current;
+				break;
+			}
+			case '\b': {
+				escaped = 'b';
+				break;
+			}
+			case '\f': {
+				escaped = 'f';
 				break;
 			}
 			case '\t': {
-				current = 't';
-				doEscape = true;
+				escaped = 't';
 				break;
 			}
 			case '\r': {
-				current = 'r';
-				doEscape = true;
+				escaped = 'r';
 				break;
 			}
 			case '\n': {
-				current = 'n';
-				doEscape = true;
+				escaped = 'n';
 				break;
 			}
 			default:
 				break;
 		}
 		
-		if (doEscape)
-			result[resultLength++] = '\\';
+		lj_buffer_reserve(buffer, 6);
+		char* out = buffer->data + buffer->length;
 		
-		result[resultLength++] = current;
+		out[0] = '\\';
+		
+		if (escaped) {
+			out[1] = escaped;
+			buffer->length += 2;
+		} else {
+			// the rest of the control characters have no short form
+			memcpy(out + 1, "u00", 3);
+			out[4] = hexDigits[current >> 4];
+			out[5] = hexDigits[current & 0xF];
+			
+			buffer->length += 6;
+		}
+		
+		input = special + 1;
 	}
 	
-	// don't forget to close the string
-	result[resultLength++] = '"';
-	return result;
+	lj_buffer_putc(buffer, '"');
 }
 
-#define LJ_AUTOREALLOC_IF_NEEDED(condition, result, resultLength, resultSize) \
+/// [json_writer] container that is currently open
+typedef struct {
+	json_type_t type;
+	// values written into it so far
+	json_index_t count;
+} lj_writer_frame;
+
+struct json_writer_s {
+	// output that wasn't handed to flush yet (the whole document if there is
+	// no flush callback, which is what json_value_stringify relies on)
+	lj_buffer out;
+	// bytes already handed to flush
+	size_t flushed;
+	
+	json_writer_flush_fn flush;
+	void* context;
+	
+	// caller-owned output buffer (json_writer_new_buffer only)
+	char* target;
+	size_t targetSize;
+	
+	bool humanReadable;
+	
+	// stack of open containers
+	lj_writer_frame* stack;
+	json_index_t depth;
+	json_index_t stackSize;
+	
+	// a key was written and is waiting for its value
+	bool hasKey;
+	// the root value is complete
+	bool done;
+	// a write failed, so will all the next ones
+	bool failed;
+};
+
+/// marks the writer as failed, making it reject all the next writes
+#define LJ_WRITER_FAIL(writer, ...) \
 { \
-	if ((resultLength + condition + 2) >= resultSize) { \
-		resultSize += condition + LJ_STRINGOPS_BUFSTEP; \
-		result = realloc(result, sizeof(char) * resultSize); \
-	} \
+	ljprintf(__VA_ARGS__); \
+	writer->failed = true; \
+	return false; \
+}
+
+/// hands all the buffered output to the flush callback
+bool lj_writer_flush(json_writer_ref writer) {
+	if (!writer->flush || writer->out.length < 1 || writer->failed)
+		return !writer->failed;
+	
+	if (!writer->flush(writer->context, writer->out.data, writer->out.length))
+		LJ_WRITER_FAIL(writer, "flush callback failed after %zu bytes", writer->flushed)
+	
+	writer->flushed += writer->out.length;
+	writer->out.length = 0;
+	
+	return true;
+}
+
+/// [json_writer_new_file] flush callback
+bool lj_writer_flush_file(void* context, const char* data, const size_t length) {
+	return fwrite(data, sizeof(char), length, (FILE*)context) == length;
+}
+
+/// [json_writer_new_buffer] flush callback
+bool lj_writer_flush_target(void* context, const char* data, const size_t length) {
+	json_writer_ref writer = context;
+	
+	// always keep a byte for the NUL
+	if ((writer->flushed + length) >= writer->targetSize)
+		return false;
+	
+	memcpy(writer->target + writer->flushed, data, length);
+	return true;
+}
+
+/// adds a separator and indentation before the next item of the container
+void lj_writer_separate(json_writer_ref writer, lj_writer_frame* top) {
+	if (top->count > 0) {
+		lj_buffer_putc(&(writer->out), ',');
+		
+		if (writer->humanReadable)
+			lj_buffer_putc(&(writer->out), '\n');
+	}
+	
+	if (writer->humanReadable)
+		lj_buffer_indent(&(writer->out), writer->depth * LJ_STRINGOPS_TABSIZE);
+	
+	top->count++;
+}
+
+/// checks that a value can be written next and prepends a separator to it
+bool lj_writer_prefix(json_writer_ref writer) {
+	if (writer->failed)
+		return false;
+	else if (writer->depth < 1) {
+		if (writer->done)
+			LJ_WRITER_FAIL(writer, "the document already has a root value")
+		
+		return true;
+	}
+	
+	lj_writer_frame* top = &(writer->stack[writer->depth - 1]);
+	
+	if (top->type == JSON_TYPE_OBJECT) {
+		// the key has already taken care of the separator
+		if (!writer->hasKey)
+			LJ_WRITER_FAIL(writer, "values inside objects need a key")
+		
+		writer->hasKey = false;
+		return true;
+	}
+	
+	lj_writer_separate(writer, top);
+	return true;
+}
+
+/// finishes writing a value, flushing the output if there is enough of it
+bool lj_writer_suffix(json_writer_ref writer) {
+	if (writer->depth < 1)
+		writer->done = true;
+	
+	if (writer->flush && writer->out.length >= LJ_WRITER_FLUSHSIZE)
+		return lj_writer_flush(writer);
+	
+	return !writer->failed;
+}
+
+/// writes a preformatted primitive value
+bool lj_writer_raw(json_writer_ref writer, const char* data, const size_t length) {
+	if (!lj_writer_prefix(writer))
+		return false;
+	
+	lj_buffer_append(&(writer->out), data, length);
+	return lj_writer_suffix(writer);
+}
+
+/// starts a container of the specified type
+bool lj_writer_begin(json_writer_ref writer, const json_type_t type) {
+	if (!lj_writer_prefix(writer))
+		return false;
+	
+	lj_buffer_putc(&(writer->out), (type == JSON_TYPE_ARRAY) ? '[' : '{');
+	
+	if (writer->humanReadable)
+		lj_buffer_putc(&(writer->out), '\n');
+	
+	if (writer->depth >= writer->stackSize) {
+		writer->stackSize = writer->stackSize ? writer->stackSize * 2 : LJ_PARSE_STACK_BASE;
+		writer->stack = realloc(writer->stack, sizeof(lj_writer_frame) * writer->stackSize);
+	}
+	
+	lj_writer_frame frame = { type, 0 };
+	writer->stack[writer->depth++] = frame;
+	
+	return lj_writer_suffix(writer);
 }
 
-char* json_value_make_string_repr(const json_value_ref root,
-								  json_index_t* lengthP,
-								  const bool humanReadable,
-								  const json_index_t baseSpaceCount) {
-	// prepare resulting buffer
-	json_index_t resultSize = LJ_STRINGOPS_BUFSTEP;
-	json_index_t resultLength = 0;
-	char* result = calloc(resultSize, sizeof(char));
+/// ends the innermost container, which has to be of the specified type
+bool lj_writer_end(json_writer_ref writer, const json_type_t type) {
+	if (writer->failed)
+		return false;
+	else if (writer->depth < 1 || writer->stack[writer->depth - 1].type != type)
+		LJ_WRITER_FAIL(writer, "no matching container to end")
+	else if (writer->hasKey)
+		LJ_WRITER_FAIL(writer, "the last key is missing its value")
 	
-	// used in humanReadable mode - space count
-	json_index_t spaceCount = baseSpaceCount;
+	const json_index_t count = writer->stack[--(writer->depth)].count;
 	
-	if (LJ_IS_CONTAINER(root)) {
-		// add the container beginning token first
-		result[resultLength++] = (root->type == JSON_TYPE_ARRAY) ? '[' : '{';
-		LJ_AUTOREALLOC_IF_NEEDED(2, result, resultLength, resultSize)
+	if (writer->humanReadable) {
+		if (count > 0)
+			lj_buffer_putc(&(writer->out), '\n');
 		
-		spaceCount += LJ_STRINGOPS_TABSIZE;
-		
-		// add a new line before listing container items
-		if (humanReadable)
-			result[resultLength++] = '\n';
-		
-		// iterate through each child and add its stringified form
-		json_value_ref child = root->child;
-		
-		while (child) {
-			if (humanReadable) {
-				// prepend the necessary spaces
-				LJ_AUTOREALLOC_IF_NEEDED(spaceCount + 1, result, resultLength, resultSize)
-				
-				for (json_index_t sc = 0; sc < spaceCount; sc++)
-					result[resultLength++] = ' ';
-			}
-		
-			if (root->type == JSON_TYPE_OBJECT) {
-				// need not to forget to add the keys
-				char* escapedKey = lj_unescape_str(child->key);
-				json_index_t escapedKeyLength = escapedKey ? strlen(escapedKey) : 0;
-				
-				ljprintf("escapedKey = %s", escapedKey);
-				
-				// allocate buffer space first
-				LJ_AUTOREALLOC_IF_NEEDED(escapedKeyLength + 3, result, resultLength, resultSize)
-				
-				if (escapedKeyLength > 0) {
-					// add the converted quoted key
-					strcat(result, escapedKey);
-					resultLength += escapedKeyLength;
-					
-					result[resultLength++] = ':';
-					
-					if (humanReadable)
-						result[resultLength++] = ' ';
-				}
-			}
-			
-			// convert the child object into a document representation too
-			json_index_t reprLength = 0;
-			char* repr = json_value_make_string_repr(child, &reprLength, humanReadable, spaceCount);
-			
-			if (reprLength > 0) {
-				// add the representation to our final string
-				LJ_AUTOREALLOC_IF_NEEDED(reprLength + 3, result, resultLength, resultSize)
-				
-				strcat(result, repr);
-				resultLength += reprLength;
-			}
-			
-			child = child->next;
-			
-			// don't forget to add a comma seperating other values if there
-			// are many of them
-			if (child)
-				result[resultLength++] = ',';
-			
-			// new line on each child item
-			if (humanReadable)
-				result[resultLength++] = '\n';
-		}
-		
-		spaceCount -= LJ_STRINGOPS_TABSIZE;
-		
-		// end the container too
-		LJ_AUTOREALLOC_IF_NEEDED(spaceCount + 1, result, resultLength, resultSize)
-		
-		if (humanReadable) {
-			// prepend the last few spaces before container end
-			for (json_index_t sc = 0; sc < spaceCount; sc++)
-				result[resultLength++] = ' ';
+		lj_buffer_indent(&(writer->out), writer->depth * LJ_STRINGOPS_TABSIZE);
+	}
+	
+	lj_buffer_putc(&(writer->out), (type == JSON_TYPE_ARRAY) ? ']' : '}');
+	return lj_writer_suffix(writer);
+}
+
+/// [json_writer_value] container being written and its next child to write
+typedef struct {
+	json_value_ref container;
+	json_value_ref child;
+} lj_writer_cursor;
+
+/// [json_writer_value] writes the specified non-container value
+bool lj_writer_scalar(json_writer_ref writer, const json_value_ref value) {
+	switch (value->type) {
+		case JSON_TYPE_STRING: {
+			const char* str = LJ_VALUE_STR(value);
+			return json_writer_string_n(writer, str ? str : "", value->count);
 		}
-		
-		result[resultLength++] = (root->type == JSON_TYPE_ARRAY) ? ']' : '}';
-	} else {
-		switch (root->type) {
-			case JSON_TYPE_STRING: {
-				// use its own quoted representation instead
-				free(result);
-				
-				result = lj_unescape_str(root->strV);
-				resultLength = result ? strlen(result) : 0;
-				break;
-			}
-			case JSON_TYPE_NUMBER:
-			case JSON_TYPE_BOOLEAN: {
-				// use its strV variant
-				free(result);
-				
-				result = strdup(root->strV);
-				resultLength = strlen(result);
-				break;
-			}
-			default: {
-				// use null string
-				strcpy(result, "null");
-				resultLength = strlen(result);
-				break;
-			}
+		case JSON_TYPE_NUMBER: {
+			if (value->flags & LJ_VALUE_INT64)
+				return json_writer_int64(writer, value->v.intV);
+			else if (value->flags & LJ_VALUE_UINT64)
+				return json_writer_uint64(writer, value->v.uintV);
+			
+			return json_writer_number(writer, value->v.numV);
 		}
+		case JSON_TYPE_BOOLEAN:
+			return json_writer_boolean(writer, value->v.boolV);
+		default:
+			return json_writer_null(writer);
 	}
-	
-	LJ_IF_NOT_NULL(lengthP, resultLength)
-	return result;
 }
 
 //
@@ -959,13 +4369,17 @@ char* json_value_make_string_repr(const json_value_ref root,
 //
 
 json_value_ref json_value_init_string(const char* str) {
+	return json_value_init_string_n(str, str ? strlen(str) : 0);
+}
+
+json_value_ref json_value_init_string_n(const char* str, const size_t length) {
 	if (!str) {
 		ljprintf("NULL string provided as input, cannot continue");
 		return NULL;
 	}
 	
 	json_value_ref result = json_value_init(JSON_TYPE_STRING);
-	json_value_set_string(result, str);
+	json_value_set_string_n(result, str, length);
 	
 	return result;
 }
@@ -977,6 +4391,20 @@ json_value_ref json_value_init_number(const json_number_t num) {
 	return result;
 }
 
+json_value_ref json_value_init_int64(const int64_t num) {
+	json_value_ref result = json_value_init(JSON_TYPE_NUMBER);
+	json_value_set_int64(result, num);
+	
+	return result;
+}
+
+json_value_ref json_value_init_uint64(const uint64_t num) {
+	json_value_ref result = json_value_init(JSON_TYPE_NUMBER);
+	json_value_set_uint64(result, num);
+	
+	return result;
+}
+
 json_value_ref json_value_init_boolean(const bool bv) {
 	json_value_ref result = json_value_init(JSON_TYPE_BOOLEAN);
 	json_value_set_boolean(result, bv);
@@ -1000,8 +4428,12 @@ json_value_ref json_value_init_array() {
 }
 
 bool json_value_set_string(json_value_ref value, const char* str) {
-	if (!value || !str) {
-		ljprintf("value = <%p>, str = <%p>, something is NULL", value, str);
+	return json_value_set_string_n(value, str, str ? strlen(str) : 0);
+}
+
+bool json_value_set_string_n(json_value_ref value, const char* str, const size_t length) {
+	if (!value || !str || LJ_IS_READONLY(value)) {
+		ljprintf("value = <%p>, str = <%p>, something is NULL or read-only", value, str);
 		return false;
 	}
 	
@@ -1009,66 +4441,102 @@ bool json_value_set_string(json_value_ref value, const char* str) {
 	LJ_CLEAN_PREVIOUS_VALUE(value)
 	value->type = JSON_TYPE_STRING;
 	
-	// set both string and numeric values
-	value->strV = strdup(str);
-	value->numV = ljatof(value->strV);
+	// the numeric value is only parsed on demand by json_value_get_number
+	lj_value_store_string(value, str, length, NULL, NULL);
 	return true;
 }
 
 bool json_value_set_number(json_value_ref value, const json_number_t num) {
-	if (!value)
+	if (!value || LJ_IS_READONLY(value))
 		return false;
 		
 	LJ_CLEAN_PREVIOUS_VALUE(value)
 	value->type = JSON_TYPE_NUMBER;
 	
-	value->strV = ljftoa(value->numV);
-	value->numV = num;
+	value->v.numV = num;
+	return true;
+}
+
+bool json_value_set_int64(json_value_ref value, const int64_t num) {
+	if (!value || LJ_IS_READONLY(value))
+		return false;
+	
+	LJ_CLEAN_PREVIOUS_VALUE(value)
+	value->type = JSON_TYPE_NUMBER;
+	
+	value->v.intV = num;
+	value->flags |= LJ_VALUE_INT64;
+	return true;
+}
+
+bool json_value_set_uint64(json_value_ref value, const uint64_t num) {
+	if (!value || LJ_IS_READONLY(value))
+		return false;
+	
+	LJ_CLEAN_PREVIOUS_VALUE(value)
+	value->type = JSON_TYPE_NUMBER;
+	
+	value->v.uintV = num;
+	value->flags |= (num <= INT64_MAX) ? LJ_VALUE_INT64 : LJ_VALUE_UINT64;
 	return true;
 }
 
 bool json_value_set_boolean(json_value_ref value, const bool bv) {
-	if (!value)
+	if (!value || LJ_IS_READONLY(value))
 		return false;
 		
 	LJ_CLEAN_PREVIOUS_VALUE(value)
 	value->type = JSON_TYPE_BOOLEAN;
 	
-	value->strV = bv ? strdup("true") : strdup("false");
-	value->numV = bv;
+	value->v.boolV = bv;
 	return true;
 }
 
 void json_value_release_tree(json_value_ref value) {
 	if (!value)
 		return;
+	else if (LJ_IS_READONLY(value)) {
+		ljprintf("value <%p> belongs to a document, use json_document_release", value);
+		return;
+	}
 		
 	ljprintf("value <%p> type = %u awaiting release (tree)", value, value->type);
 	
-	// cache referenced values first
-	json_value_ref child = value->child;
-	json_value_ref next = value->next;
-	
-	// release itself
-	json_value_release(value);
-	
-	// release all referenced children
-	json_value_release_tree(child);
-	// release all referenced neighboring items
-	json_value_release_tree(next);
+	while (value) {
+		json_value_ref next = value->next;
+		
+		if (LJ_IS_CONTAINER(value) && value->v.c.child) {
+			// splice the children in front of the values left to release, so
+			// that neither recursion nor a separate stack is needed
+			value->v.c.last->next = next;
+			next = value->v.c.child;
+		}
+		
+		json_value_release(value);
+		value = next;
+	}
 }
 
 json_value_ref json_value_get(const json_value_ref container,
 							  const char* key) {
+	return json_value_get_n(container, key, key ? strlen(key) : 0);
+}
+
+json_value_ref json_value_get_n(const json_value_ref container,
+								const char* key, const size_t keyLength) {
 	if (!container || container->type != JSON_TYPE_OBJECT || !key) {
 		ljprintf("NULL cont./key or non-object specified as container <%p> [%u]", 
 				 container, container->type);
 		return NULL;
 	}
 	
+	// large objects have their keys hashed
+	if (container->v.c.index.keys)
+		return lj_keyindex_find(container->v.c.index.keys, key, keyLength, NULL);
+	
 	// get the first stored item first
-	json_value_ref first = container->child;
-	json_value_ref result = json_value_find_by_key(first, key, NULL);
+	json_value_ref first = container->v.c.child;
+	json_value_ref result = json_value_find_by_key(first, key, keyLength, NULL);
 	
 	return result;
 }
@@ -1077,25 +4545,26 @@ json_value_ref json_value_get_first(const json_value_ref container) {
 	if (!container || !LJ_IS_CONTAINER(container))
 		return NULL; // non-containers have no first/last item
 		
-	return container->child;
+	return container->v.c.child;
 }
 
 json_value_ref json_value_get_last(const json_value_ref container) {
 	if (!container || !LJ_IS_CONTAINER(container))
 		return NULL;
 		
-	json_value_ref last = container->child;
-	last = json_value_get_neighbor(last, 0, true, NULL);
-	
-	return last;
+	return container->v.c.last;
 }
 
 json_value_ref json_value_get_at(const json_value_ref container,
 								 const json_index_t where) {
-	if (!container || !LJ_IS_CONTAINER(container))
+	if (!container || !LJ_IS_CONTAINER(container) || where >= container->count)
 		return NULL; // unavailable
+	else if (container->type == JSON_TYPE_ARRAY && container->v.c.index.items) {
+		// large arrays have their items stored contiguously
+		return container->v.c.index.items->items[where];
+	}
 		
-	json_value_ref found = json_value_get_neighbor(container->child,
+	json_value_ref found = json_value_get_neighbor(container->v.c.child,
 												   where, false, NULL);
 	return found;
 }
@@ -1106,41 +4575,55 @@ json_index_t json_value_get_count(const json_value_ref container) {
 	else if (!LJ_IS_CONTAINER(container))
 		return 1; // only one item, which is self
 	
-	json_index_t result = 0;
-	json_value_get_neighbor(container->child, 0, true, &result);
-	
-	return result;
+	return container->count;
 }
 
 bool json_value_set(const json_value_ref container, const char* key,
 					json_value_ref value) {
-	if (!container || !key || strlen(key) < 1 || 
+	return json_value_set_n(container, key, key ? strlen(key) : 0, value);
+}
+
+bool json_value_set_n(const json_value_ref container, const char* key,
+					  const size_t keyLength, json_value_ref value) {
+	if (!container || !key || keyLength < 1 || 
 		container->type != JSON_TYPE_OBJECT) {
 		ljprintf("container <%p> or key <%p> is NULL or the former is not an object", 
 				 container, key);
 		return false;
+	} else if (!value || LJ_IS_READONLY(container) || LJ_IS_READONLY(value)) {
+		ljprintf("value <%p> is NULL or a document-owned value is involved", value);
+		return false;
 	}
 	
 	// adjust soon-to-be-added value's key
-	free(value->key);
-	value->key = strdup(key);
-	
-	// get the last stored value if we have to append the new value
-	json_value_ref last = json_value_get_last(container);
+	lj_value_release_key(value);
+	lj_value_store_key(value, key, keyLength, NULL);
 	
 	// find an item that is named the same to maybe replace it
 	json_value_ref foundBack = NULL;
-	json_value_ref found = json_value_find_by_key(container->child, key, &foundBack);
+	json_value_ref found = NULL;
+	
+	if (container->v.c.index.keys)
+		found = lj_keyindex_find(container->v.c.index.keys, key, keyLength, &foundBack);
+	else
+		found = json_value_find_by_key(container->v.c.child, key, keyLength, &foundBack);
 	
 	if (found) {
 		ljprintf("found value, found = <%p>, key = \"%s\", type = %u",
-				 found, found->key, found->type);
+				 found, LJ_VALUE_KEY(found), found->type);
 		ljprintf("foundBack = <%p>, key = \"%s\"", foundBack, 
-				 foundBack ? foundBack->key : "-");
+				 foundBack ? LJ_VALUE_KEY(foundBack) : "-");
 	
 		// will be editing an existing value
 		json_value_ref foundNext = found->next;
 		
+		if (container->v.c.index.keys) {
+			lj_keyindex_replace(container->v.c.index.keys, found, value);
+			
+			if (foundNext)
+				lj_keyindex_relink(container->v.c.index.keys, foundNext, value);
+		}
+		
 		// clean up this one
 		found->next = NULL;
 		json_value_release_tree(found);
@@ -1151,23 +4634,96 @@ bool json_value_set(const json_value_ref container, const char* key,
 		if (foundBack)
 			foundBack->next = value;
 		
-		if (container->child == found)
-			container->child = value;
-	} else if (last)
-		last->next = value;
-	else
-		container->child = value;
-		
+		if (container->v.c.child == found)
+			container->v.c.child = value;
+		if (container->v.c.last == found)
+			container->v.c.last = value;
+	} else
+		lj_container_append(container, value, NULL, NULL);
+	
+#ifdef LJ_VALUE_PARENT
 	value->parent = container;
+#endif
 	return true;
 }
 
 const char* json_value_get_string(const json_value_ref value) {
-	return (value ? value->strV : NULL);
+	if (!value || value->type != JSON_TYPE_STRING)
+		return NULL; // other values have to be stringified
+	
+	return LJ_VALUE_STR(value);
+}
+
+const char* json_value_get_string_n(const json_value_ref value, size_t* lengthP) {
+	if (!value || value->type != JSON_TYPE_STRING) {
+		LJ_IF_NOT_NULL(lengthP, 0)
+		return NULL;
+	}
+	
+	LJ_IF_NOT_NULL(lengthP, value->count)
+	return LJ_VALUE_STR(value);
 }
 
 json_number_t json_value_get_number(const json_value_ref value) {
-	return (value ? value->numV : 0);
+	json_number_t number = 0.0;
+	uint64_t integer = 0;
+	
+	lj_value_number(value, &number, &integer);
+	return number;
+}
+
+int64_t json_value_get_int64(const json_value_ref value) {
+	json_number_t number = 0.0;
+	uint64_t integer = 0;
+	
+	switch (lj_value_number(value, &number, &integer)) {
+		case JSON_INTEGER_SIGNED:
+			return (int64_t)integer;
+		case JSON_INTEGER_UNSIGNED:
+			return INT64_MAX; // these never fit
+		default:
+			break;
+	}
+	
+	// truncate everything else, clamping it to the range of int64_t
+	if (isnan(number))
+		return 0;
+	else if (number <= -9223372036854775808.0)
+		return INT64_MIN;
+	else if (number >= 9223372036854775808.0)
+		return INT64_MAX;
+	
+	return (int64_t)number;
+}
+
+uint64_t json_value_get_uint64(const json_value_ref value) {
+	json_number_t number = 0.0;
+	uint64_t integer = 0;
+	
+	switch (lj_value_number(value, &number, &integer)) {
+		case JSON_INTEGER_SIGNED:
+			return ((int64_t)integer < 0) ? 0 : integer;
+		case JSON_INTEGER_UNSIGNED:
+			return integer;
+		default:
+			break;
+	}
+	
+	if (isnan(number) || number <= 0.0)
+		return 0;
+	else if (number >= 18446744073709551616.0)
+		return UINT64_MAX;
+	
+	return (uint64_t)number;
+}
+
+json_integer_t json_value_get_integral(const json_value_ref value) {
+	if (!value || value->type != JSON_TYPE_NUMBER)
+		return JSON_INTEGER_NONE;
+	else if (value->flags & LJ_VALUE_INT64)
+		return JSON_INTEGER_SIGNED;
+	
+	return (value->flags & LJ_VALUE_UINT64) ? JSON_INTEGER_UNSIGNED : JSON_INTEGER_NONE;
 }
 
 bool json_value_get_boolean(const json_value_ref value) {
@@ -1175,7 +4731,12 @@ bool json_value_get_boolean(const json_value_ref value) {
 }
 
 const char* json_value_get_key(const json_value_ref value) {
-	return (value ? value->key : NULL);
+	return (value ? LJ_VALUE_KEY(value) : NULL);
+}
+
+const char* json_value_get_key_n(const json_value_ref value, size_t* lengthP) {
+	LJ_IF_NOT_NULL(lengthP, value ? LJ_VALUE_KEYLEN(value) : 0)
+	return (value ? LJ_VALUE_KEY(value) : NULL);
 }
 
 json_type_t json_value_get_type(const json_value_ref value) {
@@ -1190,44 +4751,314 @@ bool json_value_push(json_value_ref container, json_value_ref value) {
 	} else if (!value) {
 		ljprintf("NULL value specified");
 		return false;
+	} else if (LJ_IS_READONLY(container) || LJ_IS_READONLY(value)) {
+		ljprintf("document-owned values are read-only");
+		return false;
 	}
 	
-	if (container->child) {
-		// link to last value
-		json_value_ref last = json_value_get_last(container);
-		
-		last->next = value;
-		value->parent = container;
-	} else {
-		container->child = value;
-		value->parent = container;
-	}
+	lj_container_append(container, value, NULL, NULL);
 	
+#ifdef LJ_VALUE_PARENT
+	value->parent = container;
+#endif
 	return true;
 }
 
+bool json_value_remove_first(json_value_ref container) {
+	return lj_container_remove_at(container, 0);
+}
+
+bool json_value_remove_last(json_value_ref container) {
+	if (!container || !LJ_IS_CONTAINER(container) || container->count < 1)
+		return false;
+	
+	return lj_container_remove_at(container, container->count - 1);
+}
+
+bool json_value_remove_at(json_value_ref container,
+						  const json_index_t where) {
+	return lj_container_remove_at(container, where);
+}
+
 char* json_value_stringify(const json_value_ref container,
 						   const bool humanReadable) {
+	return json_value_stringify_n(container, humanReadable, NULL);
+}
+
+char* json_value_stringify_n(const json_value_ref container,
+							 const bool humanReadable,
+							 size_t* lengthP) {
 	if (!container) {
 		ljprintf("NULL root object provided");
 		return NULL;
 	}
 	
-	char* repr = json_value_make_string_repr(container, NULL, humanReadable, 0);
-	return repr;
+	// without a flush callback the whole document stays in writer.out
+	struct json_writer_s writer = { .humanReadable = humanReadable };
+	const bool success = json_writer_value(&writer, container);
+	
+	free(writer.stack);
+	
+	if (!success) {
+		free(writer.out.data);
+		return NULL;
+	}
+	
+	writer.out.data[writer.out.length] = '\0';
+	
+	LJ_IF_NOT_NULL(lengthP, writer.out.length)
+	return writer.out.data;
 }
 
 void json_value_release(json_value_ref value) {
 	if (!value)
 		return;
+	else if (LJ_IS_READONLY(value)) {
+		ljprintf("value <%p> belongs to a document, use json_document_release", value);
+		return;
+	}
 	
-	ljprintf("value <%p> type = %u strV = \"%s\" awaiting release", 
-			 value, value->type, value->strV);
+	ljprintf("value <%p> type = %u awaiting release", value, value->type);
 	
-	// release the only few manually managed values
-	free(value->key);
-	free(value->strV);
+	// release the only few manually managed values (unless they point into
+	// an insitu-parsed buffer)
+	lj_value_release_key(value);
+	
+	if (value->type == JSON_TYPE_STRING &&
+		!(value->flags & (LJ_VALUE_BORROWED_STR | LJ_VALUE_INLINE_STR)))
+		free(value->v.strV);
+	else if (value->type == JSON_TYPE_OBJECT)
+		lj_keyindex_release(value->v.c.index.keys, NULL, NULL);
+	else if (value->type == JSON_TYPE_ARRAY)
+		lj_itemvector_release(value->v.c.index.items, NULL, NULL);
 	
 	// release itself
 	free(value);
-}
\ No newline at end of file
+}
+
+//
+// json_writer - public
+//
+
+json_writer_ref json_writer_new(json_writer_flush_fn flush, void* context,
+								const bool humanReadable) {
+	if (!flush) {
+		ljprintf("NULL flush callback provided");
+		return NULL;
+	}
+	
+	json_writer_ref result = ljmalloc_s(json_writer_s);
+	result->flush = flush;
+	result->context = context;
+	result->humanReadable = humanReadable;
+	
+	return result;
+}
+
+json_writer_ref json_writer_new_file(FILE* file, const bool humanReadable) {
+	if (!file) {
+		ljprintf("NULL file provided");
+		return NULL;
+	}
+	
+	return json_writer_new(lj_writer_flush_file, file, humanReadable);
+}
+
+json_writer_ref json_writer_new_buffer(char* buffer, const size_t size,
+									   const bool humanReadable) {
+	if (!buffer || size < 1) {
+		ljprintf("buffer = <%p>, size = %zu, no space to write into", buffer, size);
+		return NULL;
+	}
+	
+	json_writer_ref result = json_writer_new(lj_writer_flush_target, NULL, humanReadable);
+	result->context = result;
+	result->target = buffer;
+	result->targetSize = size;
+	
+	return result;
+}
+
+bool json_writer_begin_object(json_writer_ref writer) {
+	return writer && lj_writer_begin(writer, JSON_TYPE_OBJECT);
+}
+
+bool json_writer_begin_array(json_writer_ref writer) {
+	return writer && lj_writer_begin(writer, JSON_TYPE_ARRAY);
+}
+
+bool json_writer_end_object(json_writer_ref writer) {
+	return writer && lj_writer_end(writer, JSON_TYPE_OBJECT);
+}
+
+bool json_writer_end_array(json_writer_ref writer) {
+	return writer && lj_writer_end(writer, JSON_TYPE_ARRAY);
+}
+
+bool json_writer_key(json_writer_ref writer, const char* key) {
+	return json_writer_key_n(writer, key, key ? strlen(key) : 0);
+}
+
+bool json_writer_key_n(json_writer_ref writer, const char* key, const size_t length) {
+	if (!writer || writer->failed)
+		return false;
+	else if (!key)
+		LJ_WRITER_FAIL(writer, "NULL key provided")
+	else if (writer->depth < 1 || writer->stack[writer->depth - 1].type != JSON_TYPE_OBJECT)
+		LJ_WRITER_FAIL(writer, "key \"%s\" outside of an object", key)
+	else if (writer->hasKey)
+		LJ_WRITER_FAIL(writer, "key \"%s\" follows another key", key)
+	
+	lj_writer_separate(writer, &(writer->stack[writer->depth - 1]));
+	
+	lj_buffer_append_string(&(writer->out), key, length);
+	lj_buffer_putc(&(writer->out), ':');
+	
+	if (writer->humanReadable)
+		lj_buffer_putc(&(writer->out), ' ');
+	
+	writer->hasKey = true;
+	return lj_writer_suffix(writer);
+}
+
+bool json_writer_string(json_writer_ref writer, const char* str) {
+	return json_writer_string_n(writer, str, str ? strlen(str) : 0);
+}
+
+bool json_writer_string_n(json_writer_ref writer, const char* str, const size_t length) {
+	if (!writer || !str || !lj_writer_prefix(writer))
+		return false;
+	
+	lj_buffer_append_string(&(writer->out), str, length);
+	return lj_writer_suffix(writer);
+}
+
+bool json_writer_number(json_writer_ref writer, const json_number_t num) {
+	if (!writer || !lj_writer_prefix(writer))
+		return false;
+	
+	// format straight into the output buffer
+	lj_buffer* out = &(writer->out);
+	lj_buffer_reserve(out, LJ_STRINGOPS_NUMMAX);
+	out->length += lj_format_number(num, out->data + out->length);
+	
+	return lj_writer_suffix(writer);
+}
+
+bool json_writer_int64(json_writer_ref writer, const int64_t num) {
+	if (!writer || !lj_writer_prefix(writer))
+		return false;
+	
+	lj_buffer* out = &(writer->out);
+	lj_buffer_reserve(out, LJ_STRINGOPS_NUMMAX);
+	out->length += lj_format_integer((num < 0) ? (0 - (uint64_t)num) : (uint64_t)num,
+									 num < 0, out->data + out->length);
+	
+	return lj_writer_suffix(writer);
+}
+
+bool json_writer_uint64(json_writer_ref writer, const uint64_t num) {
+	if (!writer || !lj_writer_prefix(writer))
+		return false;
+	
+	lj_buffer* out = &(writer->out);
+	lj_buffer_reserve(out, LJ_STRINGOPS_NUMMAX);
+	out->length += lj_format_integer(num, false, out->data + out->length);
+	
+	return lj_writer_suffix(writer);
+}
+
+bool json_writer_boolean(json_writer_ref writer, const bool bv) {
+	return writer && lj_writer_raw(writer, bv ? "true" : "false", bv ? 4 : 5);
+}
+
+bool json_writer_null(json_writer_ref writer) {
+	return writer && lj_writer_raw(writer, "null", 4);
+}
+
+bool json_writer_value(json_writer_ref writer, const json_value_ref value) {
+	if (!writer || !value)
+		return false;
+	else if (!LJ_IS_CONTAINER(value))
+		return lj_writer_scalar(writer, value);
+	
+	// containers being written and the next child of each of them
+	lj_writer_cursor* stack = NULL;
+	json_index_t depth = 0;
+	json_index_t stackSize = 0;
+	
+	json_value_ref current = value;
+	bool success = true;
+	
+	while (success) {
+		if (LJ_IS_CONTAINER(current)) {
+			// go deeper
+			if (!lj_writer_begin(writer, current->type)) {
+				success = false;
+				break;
+			} else if (depth >= stackSize) {
+				stackSize = stackSize ? stackSize * 2 : LJ_PARSE_STACK_BASE;
+				stack = realloc(stack, sizeof(lj_writer_cursor) * stackSize);
+			}
+			
+			lj_writer_cursor cursor = { current, current->v.c.child };
+			stack[depth++] = cursor;
+		} else
+			success = lj_writer_scalar(writer, current);
+		
+		if (depth < 1)
+			break;
+		
+		// pick the next child to write, ending all the finished containers
+		lj_writer_cursor* top = &(stack[depth - 1]);
+		
+		while (success && !top->child) {
+			success = lj_writer_end(writer, top->container->type);
+			
+			if (--depth < 1)
+				break;
+			
+			top = &(stack[depth - 1]);
+		}
+		
+		if (!success || depth < 1)
+			break;
+		
+		current = top->child;
+		top->child = current->next;
+		
+		if (top->container->type == JSON_TYPE_OBJECT) {
+			const char* key = LJ_VALUE_KEY(current);
+			success = json_writer_key_n(writer, key ? key : "", LJ_VALUE_KEYLEN(current));
+		}
+	}
+	
+	free(stack);
+	return success;
+}
+
+bool json_writer_finish(json_writer_ref writer, size_t* lengthP) {
+	if (!writer || !lj_writer_flush(writer))
+		return false;
+	
+	if (writer->target)
+		writer->target[writer->flushed] = '\0';
+	
+	LJ_IF_NOT_NULL(lengthP, writer->flushed + writer->out.length)
+	
+	if (writer->depth > 0 || !writer->done) {
+		ljprintf("the document is incomplete, %u containers left open", writer->depth);
+		return false;
+	}
+	
+	return true;
+}
+
+void json_writer_release(json_writer_ref writer) {
+	if (!writer)
+		return;
+	
+	free(writer->out.data);
+	free(writer->stack);
+	free(writer);
+}
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <stdio.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -10,6 +12,16 @@ typedef uint32_t json_index_t;
 /// JSON numeric value representation in C
 typedef double json_number_t;
 
+/// kinds of exactly stored integral numbers, see json_value_get_int64
+typedef enum {
+	// not an integer or doesn't fit into 64 bits, only stored as json_number_t
+	JSON_INTEGER_NONE = 0,
+	// fits into int64_t
+	JSON_INTEGER_SIGNED,
+	// positive and only fits into uint64_t
+	JSON_INTEGER_UNSIGNED
+} json_integer_t;
+
 /// JSON value type enum
 typedef enum {
 	JSON_TYPE_NULL = 0,
@@ -27,6 +39,28 @@ typedef enum {
 /// JSON value object
 typedef struct json_value_s* json_value_ref;
 
+/// JSON document owning all of its values, see json_document_parse
+typedef struct json_document_s* json_document_ref;
+
+/// incremental JSON parser fed chunk by chunk, see json_stream_new
+typedef struct json_stream_s* json_stream_ref;
+
+/// reusable parsing context recycling released values, see json_parser_new
+typedef struct json_parser_s* json_parser_ref;
+
+/// pull parser reading a JSON document token by token, see json_reader_new
+typedef struct json_reader_s* json_reader_ref;
+
+/// streaming JSON document writer, see json_writer_new
+typedef struct json_writer_s* json_writer_ref;
+
+///
+/// json_writer output callback, receives the next length bytes of the
+/// document. Returning false aborts writing
+///
+typedef bool (*json_writer_flush_fn)(void* context, const char* data,
+									 const size_t length);
+
 /// JSON parsing error structure
 typedef struct {
 	// if this is true, then all else is valid
@@ -40,6 +74,75 @@ typedef struct {
 	char* message;
 } json_error;
 
+/// kinds of tokens read by json_reader_next
+typedef enum {
+	// end of the document
+	JSON_TOKEN_END = 0,
+	
+	JSON_TOKEN_START_OBJECT,
+	JSON_TOKEN_END_OBJECT,
+	JSON_TOKEN_START_ARRAY,
+	JSON_TOKEN_END_ARRAY,
+	
+	JSON_TOKEN_KEY,
+	JSON_TOKEN_STRING,
+	JSON_TOKEN_NUMBER,
+	JSON_TOKEN_BOOLEAN,
+	JSON_TOKEN_NULL,
+	
+	// parsing error, see json_error
+	JSON_TOKEN_ERROR
+} json_token_t;
+
+/// a single token of a JSON document
+typedef struct {
+	json_token_t type;
+	// offset of the token in the input
+	size_t offset;
+	
+	// unescaped key/string contents or the number as written in the
+	// document - not NUL-terminated, valid until the next token is read
+	const char* data;
+	size_t length;
+	
+	// converted number (or 1/0 for booleans)
+	json_number_t number;
+	// exact value of integral numbers that fit into 64 bits
+	json_integer_t integral;
+	union {
+		int64_t i;
+		uint64_t u;
+	} integer;
+} json_token;
+
+///
+/// json_parse_events callbacks, each of them can be NULL. Strings, keys and
+/// numbers are passed as length bytes which are not necessarily NUL-terminated
+/// and stay valid only until the callback returns. Returning false from any
+/// callback stops parsing with an error
+///
+typedef struct {
+	bool (*start_object)(void* context);
+	bool (*end_object)(void* context);
+	bool (*start_array)(void* context);
+	bool (*end_array)(void* context);
+	
+	bool (*key)(void* context, const char* key, const size_t length);
+	bool (*string)(void* context, const char* str, const size_t length);
+	// repr is the number exactly as it is written in the document
+	bool (*number)(void* context, const json_number_t num,
+				   const char* repr, const size_t length);
+	bool (*boolean)(void* context, const bool bv);
+	bool (*null)(void* context);
+	
+	// integral numbers that fit into int64_t/uint64_t respectively, if
+	// these are NULL, such numbers are passed to number instead
+	bool (*int64)(void* context, const int64_t num,
+				  const char* repr, const size_t length);
+	bool (*uint64)(void* context, const uint64_t num,
+				   const char* repr, const size_t length);
+} json_handler;
+
 ///
 /// parses the specified C string containing a valid JSON document and returns
 /// the root container containing all the other values. On error, *errorP is 
@@ -47,11 +150,178 @@ typedef struct {
 /// returned
 ///
 json_value_ref json_parse(const char* input, json_error* errorP);
+///
+/// same as json_parse, but parses exactly length bytes from input, which
+/// doesn't need to be NUL-terminated. Nothing past input + length is ever
+/// read, so slices of larger buffers can be parsed without copying them
+///
+json_value_ref json_parse_n(const char* input, const size_t length,
+							json_error* errorP);
+
+///
+/// parses the first JSON document stored in length bytes of input, ignoring
+/// anything that follows it. *consumedP is set to the amount of bytes taken
+/// by the document and the whitespace after it, so that the next one can be
+/// parsed by calling this again with input + *consumedP
+///
+json_value_ref json_parse_next(const char* input, const size_t length,
+							   size_t* consumedP, json_error* errorP);
+///
+/// parses all JSON documents stored in length bytes of input, which may be
+/// separated by newlines (JSON Lines) or any other whitespace, or directly
+/// follow each other. Returns an array holding the documents in order, which
+/// is empty if the input is empty or only holds whitespace
+///
+json_value_ref json_parse_batch(const char* input, const size_t length,
+								json_error* errorP);
+
+///
+/// parses length bytes of input just like json_parse_n, but allocates every
+/// value, key and string of the document from a single arena owned by the
+/// returned json_document. Values of a document are read-only - they can't be
+/// modified, attached to other containers or released on their own, as all of
+/// them are released at once by json_document_release
+///
+json_document_ref json_document_parse(const char* input, const size_t length,
+									  json_error* errorP);
+/// retreives the root container of the specified document
+json_value_ref json_document_get_root(const json_document_ref document);
+/// releases the specified document together with all of its values at once
+void json_document_release(json_document_ref document);
+
+///
+/// destructive variant of json_parse_n - strings and keys are unescaped in
+/// place inside the specified buffer, and json_value_get_string and
+/// json_value_get_key return pointers into it instead of copies. The buffer
+/// is left in an unspecified state and has to outlive the returned values
+///
+json_value_ref json_parse_insitu(char* buffer, const size_t length,
+								 json_error* errorP);
+///
+/// json_document_parse counterpart of json_parse_insitu - the document's
+/// strings and keys point into the specified buffer
+///
+json_document_ref json_document_parse_insitu(char* buffer, const size_t length,
+											 json_error* errorP);
+///
+/// json_document_parse counterpart of json_parse_batch - the root of the
+/// document is an array of all the parsed documents, which share a single
+/// arena
+///
+json_document_ref json_document_parse_batch(const char* input, const size_t length,
+											json_error* errorP);
+
+///
+/// json_document_parse counterpart that splits the items of a top-level array
+/// between threads worker threads (0 picks the amount of CPUs), each of them
+/// with its own arena. Small inputs and other kinds of roots are parsed on
+/// the calling thread instead
+///
+json_document_ref json_document_parse_parallel(const char* input, const size_t length,
+											   const json_index_t threads,
+											   json_error* errorP);
+/// json_document_parse_batch counterpart that splits the documents between threads
+json_document_ref json_document_parse_batch_parallel(const char* input,
+													 const size_t length,
+													 const json_index_t threads,
+													 json_error* errorP);
+
+///
+/// creates a parsing context that keeps the values and strings of trees
+/// released with json_parser_release_tree and reuses them in the following
+/// json_parse_ctx calls, so that a warmed-up context parses without calling
+/// malloc for most of them. A context must not be used by several threads at
+/// once - create one per thread instead
+///
+json_parser_ref json_parser_new(void);
+///
+/// same as json_parse_n, but takes values, strings and work buffers from the
+/// specified context. The returned tree is a regular one, so it can also be
+/// modified or released with json_value_release_tree and outlive the context
+///
+json_value_ref json_parse_ctx(json_parser_ref parser, const char* input,
+							  const size_t length, json_error* errorP);
+///
+/// json_value_release_tree counterpart that hands the memory of the released
+/// values over to the specified context instead of freeing it
+///
+void json_parser_release_tree(json_parser_ref parser, json_value_ref value);
+/// releases the specified context together with all the memory kept by it
+void json_parser_release(json_parser_ref parser);
+
+///
+/// parses length bytes of input without building any values, firing the
+/// matching callback of the specified handler for every token of the
+/// document instead. context is passed to the callbacks as is. Returns false
+/// (with *errorP set) on a parsing error or if a callback stopped parsing
+///
+bool json_parse_events(const char* input, const size_t length,
+					   const json_handler* handler, void* context,
+					   json_error* errorP);
+
+///
+/// creates an incremental parser that fires the callbacks of the specified
+/// handler (see json_parse_events) as the document is fed to it chunk by
+/// chunk with json_stream_feed
+///
+json_stream_ref json_stream_new(const json_handler* handler, void* context);
+/// creates an incremental parser that builds a tree, see json_stream_get_root
+json_stream_ref json_stream_new_tree(void);
+///
+/// parses the next length bytes of the document. Chunks can be split at any
+/// byte, including the middle of a string or a number - only the incomplete
+/// token at the end of a chunk is kept (copied) until the next one arrives
+///
+bool json_stream_feed(json_stream_ref stream, const char* chunk,
+					  const size_t length, json_error* errorP);
+/// tells the parser that the whole document has been fed to it
+bool json_stream_finish(json_stream_ref stream, json_error* errorP);
+///
+/// retreives the root container built by a successfully finished
+/// json_stream_new_tree parser, which is owned by the caller from now on.
+/// If it is never retreived, json_stream_release releases it instead
+///
+json_value_ref json_stream_get_root(const json_stream_ref stream);
+/// releases the specified incremental parser
+void json_stream_release(json_stream_ref stream);
+
+///
+/// creates a pull parser over length bytes of input, which the caller reads
+/// token by token with json_reader_next without any values being built. The
+/// input has to outlive the reader
+///
+json_reader_ref json_reader_new(const char* input, const size_t length);
+///
+/// reads the next token of the document into *tokenP (if not NULL) and
+/// returns its type - JSON_TOKEN_END once the document is over and
+/// JSON_TOKEN_ERROR (with *errorP set) if it is malformed
+///
+json_token_t json_reader_next(json_reader_ref reader, json_token* tokenP,
+							  json_error* errorP);
+///
+/// skips the next value (or the next key together with its value) including
+/// all of its children, without reading or validating their contents. Returns
+/// the type of the first skipped token, which is JSON_TOKEN_END_OBJECT or
+/// JSON_TOKEN_END_ARRAY if the current container had no values left
+///
+json_token_t json_reader_skip(json_reader_ref reader, json_error* errorP);
+/// retreives the amount of containers the reader is currently inside of
+json_index_t json_reader_get_depth(const json_reader_ref reader);
+/// releases the specified pull parser (but not its input)
+void json_reader_release(json_reader_ref reader);
 
 /// creates a new JSON string value with the specified contents (can't be NULL)
 json_value_ref json_value_init_string(const char* str);
+///
+/// same as json_value_init_string, but copies exactly length bytes of str,
+/// which may contain NUL characters
+///
+json_value_ref json_value_init_string_n(const char* str, const size_t length);
 /// creates a new JSON numeric value with the specified number
 json_value_ref json_value_init_number(const json_number_t num);
+/// creates a new JSON numeric value holding the specified integer exactly
+json_value_ref json_value_init_int64(const int64_t num);
+json_value_ref json_value_init_uint64(const uint64_t num);
 /// creates a new JSON boolean value
 json_value_ref json_value_init_boolean(const bool bv);
 
@@ -63,24 +333,45 @@ json_value_ref json_value_init_object(void);
 /// creates an empty JSON array
 json_value_ref json_value_init_array(void);
 
-/// sets the specified value to a string
+/// sets the specified value to a string (length bytes of it for the _n variant)
 bool json_value_set_string(json_value_ref value, const char* str);
+bool json_value_set_string_n(json_value_ref value, const char* str, const size_t length);
 /// sets the specified value to a number
 bool json_value_set_number(json_value_ref value, const json_number_t num);
+/// sets the specified value to an exactly stored integer
+bool json_value_set_int64(json_value_ref value, const int64_t num);
+bool json_value_set_uint64(json_value_ref value, const uint64_t num);
 /// sets the specified value to a boolean
 bool json_value_set_boolean(json_value_ref value, const bool bv);
 
 ///
-/// retreives the string representation of the specified JSON value, if
-/// available
+/// retreives the contents of the specified JSON string value (NULL for any
+/// other type of value, use json_value_stringify for these)
 ///
 const char* json_value_get_string(const json_value_ref value);
 ///
+/// same as json_value_get_string, but also saves the length of the string
+/// (which may contain NUL characters) to *lengthP
+///
+const char* json_value_get_string_n(const json_value_ref value, size_t* lengthP);
+///
 /// retreives the numeric representation of the specified JSON value, if
-/// available
+/// available (strings are converted only if they hold a valid JSON number)
 ///
 json_number_t json_value_get_number(const json_value_ref value);
 ///
+/// retreives the integer representation of the specified JSON value. Integral
+/// numbers that fit into 64 bits are stored exactly (even above 2^53), other
+/// numbers are truncated and clamped to the range of the result type
+///
+int64_t json_value_get_int64(const json_value_ref value);
+uint64_t json_value_get_uint64(const json_value_ref value);
+///
+/// checks if the specified value is a number stored exactly as a 64-bit
+/// integer and returns its kind (JSON_INTEGER_NONE otherwise)
+///
+json_integer_t json_value_get_integral(const json_value_ref value);
+///
 /// retreives the boolean representation of the specified JSON value, if
 /// available
 ///
@@ -91,6 +382,8 @@ bool json_value_get_boolean(const json_value_ref value);
 /// stored in an object
 ///
 const char* json_value_get_key(const json_value_ref value);
+/// same as json_value_get_key, but also saves the length of the key to *lengthP
+const char* json_value_get_key_n(const json_value_ref value, size_t* lengthP);
 /// retreives stored value type
 json_type_t json_value_get_type(const json_value_ref value);
 
@@ -100,6 +393,9 @@ json_type_t json_value_get_type(const json_value_ref value);
 ///
 json_value_ref json_value_get(const json_value_ref container,
 							  const char* key);
+/// same as json_value_get, but looks up exactly keyLength bytes of key
+json_value_ref json_value_get_n(const json_value_ref container,
+								const char* key, const size_t keyLength);
 ///
 /// replaces or stores the specified value in the object with the specified 
 /// key name. Keep in mind that the value instance pointed by the last argument
@@ -107,6 +403,9 @@ json_value_ref json_value_get(const json_value_ref container,
 ///
 bool json_value_set(const json_value_ref container, const char* key,
 					json_value_ref value);
+/// same as json_value_set, but stores exactly keyLength bytes of key
+bool json_value_set_n(const json_value_ref container, const char* key,
+					  const size_t keyLength, json_value_ref value);
 
 json_value_ref json_value_get_first(const json_value_ref container);
 json_value_ref json_value_get_last(const json_value_ref container);
@@ -115,6 +414,10 @@ json_value_ref json_value_get_at(const json_value_ref container,
 
 bool json_value_push(json_value_ref container, json_value_ref value);
 
+///
+/// removes the first, the last or the specified child item from the container
+/// and releases it together with all of its affiliate values
+///
 bool json_value_remove_first(json_value_ref container);
 bool json_value_remove_last(json_value_ref container);
 bool json_value_remove_at(json_value_ref container,
@@ -129,8 +432,62 @@ json_index_t json_value_get_count(const json_value_ref container);
 /// stringifies the specified JSON value into a valid JSON document
 char* json_value_stringify(const json_value_ref container,
 						   const bool humanReadable);
+///
+/// same as json_value_stringify, but also saves the length of the resulting
+/// document (if lengthP is not NULL), sparing the caller a strlen call
+///
+char* json_value_stringify_n(const json_value_ref container,
+							 const bool humanReadable,
+							 size_t* lengthP);
 
 /// releases the specified JSON value object and all of its affiliate values
 void json_value_release_tree(json_value_ref value);
 /// releases just the specified JSON value object
 void json_value_release(json_value_ref value);
+
+///
+/// creates a writer that emits a JSON document piece by piece without
+/// building a tree, handing the output to flush every few kilobytes (and
+/// once more on json_writer_finish)
+///
+json_writer_ref json_writer_new(json_writer_flush_fn flush, void* context,
+								const bool humanReadable);
+/// creates a writer that writes the document into the specified file
+json_writer_ref json_writer_new_file(FILE* file, const bool humanReadable);
+///
+/// creates a writer that writes the document into the specified caller-owned
+/// buffer of size bytes, failing if the document (plus a NUL) doesn't fit
+///
+json_writer_ref json_writer_new_buffer(char* buffer, const size_t size,
+									   const bool humanReadable);
+
+/// starts a new object or array
+bool json_writer_begin_object(json_writer_ref writer);
+bool json_writer_begin_array(json_writer_ref writer);
+/// ends the innermost object or array
+bool json_writer_end_object(json_writer_ref writer);
+bool json_writer_end_array(json_writer_ref writer);
+
+/// writes the key of the next value inside an object
+bool json_writer_key(json_writer_ref writer, const char* key);
+bool json_writer_key_n(json_writer_ref writer, const char* key, const size_t length);
+
+/// writes a single primitive value
+bool json_writer_string(json_writer_ref writer, const char* str);
+bool json_writer_string_n(json_writer_ref writer, const char* str, const size_t length);
+bool json_writer_number(json_writer_ref writer, const json_number_t num);
+bool json_writer_int64(json_writer_ref writer, const int64_t num);
+bool json_writer_uint64(json_writer_ref writer, const uint64_t num);
+bool json_writer_boolean(json_writer_ref writer, const bool bv);
+bool json_writer_null(json_writer_ref writer);
+/// writes the specified JSON value together with all of its children
+bool json_writer_value(json_writer_ref writer, const json_value_ref value);
+
+///
+/// flushes the rest of the output and checks that the document is complete,
+/// saving its total length to *lengthP (if not NULL). Returns false if any
+/// of the writes failed or some containers weren't ended
+///
+bool json_writer_finish(json_writer_ref writer, size_t* lengthP);
+/// releases the specified writer (doesn't close its file)
+void json_writer_release(json_writer_ref writer);